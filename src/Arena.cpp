@@ -0,0 +1,65 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <algorithm>
+#include "Arena.h"
+
+// allocations are aligned to this
+static const size_t ARENA_ALIGN = 16;
+
+// _____________________________________________________________________________
+Arena::Arena() : _pos(0), _used(0), _capacity(0) {}
+
+// _____________________________________________________________________________
+Arena::~Arena() {
+  for (const auto& c : _chunks) delete[] c.data;
+}
+
+// _____________________________________________________________________________
+void* Arena::alloc(size_t n) {
+  n = (n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+  if (_chunks.empty() || _pos + n > _chunks.back().size) {
+    // at least double the capacity, to need few chunks
+    addChunk(std::max(std::max(n, ARENA_CHUNK_S), _capacity));
+  }
+
+  void* ret = _chunks.back().data + _pos;
+  _pos += n;
+  _used += n;
+  return ret;
+}
+
+// _____________________________________________________________________________
+void Arena::reset() {
+  if (_chunks.size() > 1) {
+    // replace the chunks by a single one which holds all of them
+    size_t cap = _capacity;
+    for (const auto& c : _chunks) delete[] c.data;
+    _chunks.clear();
+    _capacity = 0;
+    addChunk(cap);
+  }
+  _pos = 0;
+  _used = 0;
+}
+
+// _____________________________________________________________________________
+size_t Arena::used() const { return _used; }
+
+// _____________________________________________________________________________
+size_t Arena::capacity() const { return _capacity; }
+
+// _____________________________________________________________________________
+void Arena::addChunk(size_t size) {
+  // new[] of char is aligned for any fundamental type
+  _chunks.push_back({new char[size], size});
+  _capacity += size;
+  _pos = 0;
+}
+
+// _____________________________________________________________________________
+Arena* threadArena() {
+  static thread_local Arena arena;
+  return &arena;
+}
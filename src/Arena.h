@@ -0,0 +1,87 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <string>
+#include <vector>
+
+// minimum size of an arena chunk
+static const size_t ARENA_CHUNK_S = 64 * 1024;
+
+// bump allocator, memory is only released all at once by reset(). The
+// memory itself is kept, so after a few resets, the arena is large enough
+// and does not allocate anymore.
+class Arena {
+ public:
+  Arena();
+  ~Arena();
+
+  void* alloc(size_t n);
+
+  // release all allocations at once
+  void reset();
+
+  // bytes allocated since the last reset
+  size_t used() const;
+
+  // bytes owned by the arena
+  size_t capacity() const;
+
+ private:
+  struct Chunk {
+    char* data;
+    size_t size;
+  };
+
+  std::vector<Chunk> _chunks;
+  // position in the last chunk
+  size_t _pos;
+  size_t _used;
+  size_t _capacity;
+
+  void addChunk(size_t size);
+};
+
+// the arena of the calling thread
+Arena* threadArena();
+
+// allocator for standard containers, backed by the arena of the allocating
+// thread. Memory is never given back before the arena is reset, so objects
+// using it must not outlive the reset and must not be passed to other
+// threads.
+template <typename T>
+struct ArenaAllocator {
+  typedef T value_type;
+
+  ArenaAllocator() {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>&) {}  // NOLINT
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(threadArena()->alloc(n * sizeof(T)));
+  }
+  void deallocate(T*, size_t) {}
+};
+
+// _____________________________________________________________________________
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>&, const ArenaAllocator<U>&) {
+  return true;
+}
+
+// _____________________________________________________________________________
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>&, const ArenaAllocator<U>&) {
+  return false;
+}
+
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>
+    ArenaString;
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif  // ARENA_H_
@@ -0,0 +1,92 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include "pfxml.h"
+
+// size of the decoded test texts
+static const size_t TEXT_S = 16 * 1024 * 1024;
+
+// every text is decoded this often, the best run is reported
+static const size_t RUNS = 5;
+
+// _____________________________________________________________________________
+std::string genText(size_t entityEvery, std::mt19937* rng) {
+  // wikitext-like prose with an entity after every entityEvery bytes on
+  // average (0: no entities), the text is split into lines of ~4 KB like
+  // the page texts decode() is called on
+  static const char* WORDS[] = {"the", "of", "Freiburg", "is", "a", "city",
+                                "in", "Baden-Württemberg,", "Germany.",
+                                "(", ")", "[[", "]]", "{{", "}}", "'''"};
+  static const char* ENTS[] = {"&amp;", "&lt;", "&gt;", "&quot;", "&nbsp;",
+                               "&ndash;", "&#8211;", "&#x2F;", "&amp;lt;",
+                               "&foo;"};
+
+  std::string ret;
+  size_t sinceEnt = 0;
+  while (ret.size() < TEXT_S) {
+    if (entityEvery && sinceEnt >= entityEvery) {
+      ret += ENTS[(*rng)() % (sizeof(ENTS) / sizeof(ENTS[0]))];
+      sinceEnt = 0;
+    } else {
+      std::string w = WORDS[(*rng)() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+      ret += w;
+      sinceEnt += w.size() + 1;
+    }
+    ret += ret.size() % 4096 < 8 ? '\0' : ' ';
+  }
+  return ret;
+}
+
+// _____________________________________________________________________________
+template <typename F>
+double bench(const std::string& text, F decode) {
+  // returns the best throughput in GB/s of decode(line) over all 0-separated
+  // lines of text
+  double best = 0;
+  for (size_t r = 0; r < RUNS; r++) {
+    auto t = std::chrono::steady_clock::now();
+    for (const char* l = text.c_str(); l < text.c_str() + text.size();
+         l += strlen(l) + 1) {
+      decode(l);
+    }
+    double s = std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - t).count();
+    best = std::max(best, text.size() / s / 1e9);
+  }
+  return best;
+}
+
+// _____________________________________________________________________________
+int main() {
+  std::mt19937 rng(42);
+
+  // decode() returning a new string vs. appending to a reused buffer
+  printf("%-22s %14s %14s\n", "entity every (bytes)", "string (GB/s)",
+         "append (GB/s)");
+
+  for (size_t every : {0, 1000, 100, 20}) {
+    std::string text = genText(every, &rng);
+
+    size_t sink = 0;
+    double ret = bench(text, [&sink](const char* l) {
+      sink += pfxml::file::decode(l).size();
+    });
+
+    std::string buf;
+    double app = bench(text, [&sink, &buf](const char* l) {
+      buf.clear();
+      pfxml::file::decode(l, &buf);
+      sink += buf.size();
+    });
+
+    printf("%-22zu %14.2f %14.2f\n", every, ret, app);
+    if (!sink) return 1;
+  }
+
+  return 0;
+}
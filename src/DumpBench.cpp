@@ -0,0 +1,194 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "DumpGen.h"
+#include "WikiDumpReader.h"
+#include "WikiText.h"
+#include "pfxml.h"
+
+// every measurement is repeated this often, the best run is reported
+static const size_t RUNS = 5;
+
+// keeps the measured loops from being optimized away
+static volatile size_t sink = 0;
+
+struct Result {
+  const char* name;
+  double mbPerS;
+  double pagesPerS;
+};
+
+// _____________________________________________________________________________
+template <typename F>
+static Result bench(const char* name, size_t bytes, size_t pages, F f) {
+  // the best throughput of f, which processes bytes of pages
+  double best = 1e300;
+  for (size_t r = 0; r < RUNS; r++) {
+    auto t = std::chrono::steady_clock::now();
+    f();
+    best = std::min(best, std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - t).count());
+  }
+  Result ret = {name, bytes / best / (1024 * 1024), pages / best};
+  printf("%-32s %10.1f %12.0f\n", ret.name, ret.mbPerS, ret.pagesPerS);
+  return ret;
+}
+
+// _____________________________________________________________________________
+static void bodies(const std::string& text, const char* open,
+                   const char* close, std::vector<std::string>* ret) {
+  // the content of all outermost open ... close pairs of text
+  size_t depth = 0;
+  size_t beg = 0;
+  for (size_t i = 0; i + 1 < text.size(); i++) {
+    if (text[i] == open[0] && text[i + 1] == open[1]) {
+      if (depth++ == 0) beg = i + 2;
+      i++;
+    } else if (depth && text[i] == close[0] && text[i + 1] == close[1]) {
+      if (--depth == 0) ret->push_back(text.substr(beg, i - beg));
+      i++;
+    }
+  }
+}
+
+// _____________________________________________________________________________
+static size_t totalSize(const std::vector<std::string>& strs) {
+  size_t ret = 0;
+  for (const auto& s : strs) ret += s.size();
+  return ret;
+}
+
+// _____________________________________________________________________________
+int main(int argc, char** argv) {
+  // the results are also written as JSON to the file given as the argument
+  std::string jsonPath = argc > 1 ? argv[1] : "bench.json";
+
+  DumpGenOpts genOpts;
+
+  char tpl[] = "/tmp/dumpbench-XXXXXX";
+  int fd = mkstemp(tpl);
+  if (fd < 0) {
+    perror("mkstemp");
+    return 1;
+  }
+  close(fd);
+  std::string path = tpl;
+  {
+    std::ofstream out(path);
+    DumpGen(genOpts).dump(&out);
+  }
+
+  pfxml::file_opts opts;
+  opts.mmap = true;
+  opts.readahead = false;
+
+  size_t dumpBytes = std::ifstream(path, std::ios::ate).tellg();
+
+  // the texts of the pages which are output, as the parser sees them
+  std::vector<std::string> texts;
+  {
+    pfxml::file xml(path, opts);
+    WikiDumpReader dump(&xml, Namespaces());
+    Page page;
+    while (dump.next(&page)) texts.push_back(page.text);
+  }
+  size_t textBytes = totalSize(texts);
+
+  std::vector<std::string> links, templates;
+  for (const auto& t : texts) {
+    bodies(t, "[[", "]]", &links);
+    bodies(t, "{{", "}}", &templates);
+  }
+
+  printf("generated dump, %zu pages, %zu bytes, %zu output pages with %zu "
+         "bytes of text\n",
+         genOpts.pages, dumpBytes, texts.size(), textBytes);
+  printf("%-32s %10s %12s\n", "", "MB/s", "pages/s");
+
+  std::vector<Result> results;
+
+  // the XML, from a memory mapping to leave out the reading
+  results.push_back(
+      bench("pfxml::file::next()", dumpBytes, genOpts.pages, [&]() {
+        pfxml::file xml(path, opts);
+        size_t n = 0;
+        while (xml.next()) n++;
+        sink = n;
+      }));
+  results.push_back(
+      bench("WikiDumpReader::next()", dumpBytes, genOpts.pages, [&]() {
+        pfxml::file xml(path, opts);
+        WikiDumpReader dump(&xml, Namespaces());
+        Page page;
+        while (dump.next(&page)) sink = strlen(page.text);
+      }));
+
+  // the wikitext of the output pages
+  std::string out;
+  results.push_back(
+      bench("pfxml::file::decode()", textBytes, texts.size(), [&]() {
+        for (const auto& t : texts) {
+          out.clear();
+          pfxml::file::decode(t.c_str(), &out);
+        }
+      }));
+  results.push_back(bench("parse()", textBytes, texts.size(), [&]() {
+    // all paragraphs, not only the ones of the abstract
+    for (const auto& t : texts) parse(t.c_str(), SIZE_MAX, true, &out);
+  }));
+  results.push_back(
+      bench("parseSq()", totalSize(links), texts.size(), [&]() {
+        for (const auto& l : links) {
+          out.clear();
+          parseSq(l.c_str(), &out);
+        }
+      }));
+  results.push_back(
+      bench("parseCrl()", totalSize(templates), texts.size(), [&]() {
+        for (const auto& t : templates) {
+          out.clear();
+          parseCrl(t.c_str(), &out);
+        }
+      }));
+  results.push_back(bench("abstract()", textBytes, texts.size(), [&]() {
+    for (const auto& t : texts) abstract(t.c_str(), &out);
+  }));
+
+  unlink(path.c_str());
+
+  FILE* json = fopen(jsonPath.c_str(), "w");
+  if (!json) {
+    perror(jsonPath.c_str());
+    return 1;
+  }
+  fprintf(json,
+          "{\n  \"dump\": {\"pages\": %zu, \"article_bytes\": %zu, "
+          "\"link_every\": %zu, \"template_every\": %zu, \"table_every\": "
+          "%zu, \"entity_every\": %zu, \"seed\": %u, \"bytes\": %zu},\n"
+          "  \"results\": [\n",
+          genOpts.pages, genOpts.articleBytes, genOpts.linkEvery,
+          genOpts.templateEvery, genOpts.tableEvery, genOpts.entityEvery,
+          genOpts.seed, dumpBytes);
+  for (size_t i = 0; i < results.size(); i++) {
+    fprintf(json,
+            "    {\"name\": \"%s\", \"mb_per_s\": %.1f, \"pages_per_s\": "
+            "%.0f}%s\n",
+            results[i].name, results[i].mbPerS, results[i].pagesPerS,
+            i + 1 < results.size() ? "," : "");
+  }
+  fprintf(json, "  ]\n}\n");
+  fclose(json);
+
+  printf("results written to %s\n", jsonPath.c_str());
+  return 0;
+}
@@ -0,0 +1,222 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include "DumpGen.h"
+
+static const char* const WORDS[] = {
+    "the",     "of",      "and",        "a",        "in",       "is",
+    "was",     "city",    "river",      "located",  "Freiburg", "Germany",
+    "Black",   "Forest",  "university", "founded",  "century",  "its",
+    "by",      "with",    "population", "district", "which",    "as",
+    "Bächle",  "Münster", "Baden-Württemberg,",     "(1120)",   "known."};
+
+static const char* const LINKS[] = {
+    "[[Freiburg im Breisgau]]",
+    "[[Black Forest|Schwarzwald]]",
+    "[[Dreisam]]s",
+    "[[Baden-Württemberg, Germany|Baden-Württemberg]]",
+    "[[File:Freiburg Münster.jpg|thumb|The [[Freiburg Minster|Minster]]]]",
+    "[http://www.freiburg.de Freiburg]",
+    "[[:de:Freiburg|German article]]"};
+
+static const char* const TEMPLATES[] = {
+    "{{As of|2010|5|1}}",
+    "{{convert|10|km|mi}}",
+    "{{lang|de|Bächle}}",
+    "{{IPA-de|ˈfʁaɪbʊʁk}}",
+    "{{nowrap|Baden-Württemberg}}",
+    "{{birth date and age|1970|1|2|df=y}}",
+    "{{circa|1900}}",
+    "{{sfn|Smith|2010|p=12}}",
+    "{{efn|A note with a [[link]] and {{nowrap|a template}}.}}",
+    "<ref>{{cite web|url=http://www.freiburg.de|title=Freiburg|"
+    "accessdate=2019-05-01}}</ref>",
+    "<ref name=\"stat\" />",
+    "<!-- see talk page -->"};
+
+static const char* const ENTITIES[] = {"&nbsp;", "&ndash;", "&mdash;", "&amp;",
+                                       "&#8211;", "&#x2F;", "&lt;br /&gt;"};
+
+static const char* const SECTIONS[] = {"History", "Geography", "Climate",
+                                       "Economy", "Culture", "See also"};
+
+// _____________________________________________________________________________
+DumpGen::DumpGen(const DumpGenOpts& opts) : _opts(opts), _rng(opts.seed) {}
+
+// _____________________________________________________________________________
+size_t DumpGen::distance(size_t every) {
+  if (!every) return 0;
+  return every / 2 + _rng() % (every + 1);
+}
+
+// _____________________________________________________________________________
+const char* DumpGen::pick(const char* const* items, size_t n) {
+  return items[_rng() % n];
+}
+
+// _____________________________________________________________________________
+void DumpGen::link(std::string* out) {
+  *out += pick(LINKS, sizeof(LINKS) / sizeof(LINKS[0]));
+}
+
+// _____________________________________________________________________________
+void DumpGen::tmpl(std::string* out) {
+  *out += pick(TEMPLATES, sizeof(TEMPLATES) / sizeof(TEMPLATES[0]));
+}
+
+// _____________________________________________________________________________
+void DumpGen::entity(std::string* out) {
+  *out += pick(ENTITIES, sizeof(ENTITIES) / sizeof(ENTITIES[0]));
+}
+
+// _____________________________________________________________________________
+void DumpGen::table(std::string* out) {
+  // a results table, sometimes with a nested one in a cell
+  *out += "{| class=\"wikitable sortable\"\n! Year !! Team !! Points\n";
+  size_t rows = 3 + _rng() % 20;
+  for (size_t r = 0; r < rows; r++) {
+    *out += "|-\n| " + std::to_string(1990 + r) + " || ";
+    link(out);
+    *out += " || " + std::to_string(_rng() % 100);
+    if (_rng() % 10 == 0) *out += "\n{| class=\"small\"\n| a || b\n|}";
+    *out += '\n';
+  }
+  *out += "|}\n";
+}
+
+// _____________________________________________________________________________
+std::string DumpGen::article() {
+  // an infobox, then paragraphs of prose with the markup constructs at
+  // random distances, split into sections
+  std::string ret;
+  size_t len = distance(_opts.articleBytes);
+
+  if (_opts.templateEvery) {
+    ret += "{{Infobox settlement\n| name = Freiburg\n| image = Freiburg.jpg"
+           "\n| population = " + std::to_string(_rng() % 1000000) + "\n}}\n";
+  }
+  ret += "'''Freiburg''' ";
+
+  size_t nextLink = distance(_opts.linkEvery);
+  size_t nextTmpl = distance(_opts.templateEvery);
+  size_t nextTable = distance(_opts.tableEvery);
+  size_t nextEntity = distance(_opts.entityEvery);
+  size_t nextPara = distance(500);
+  size_t paras = 0;
+
+  while (ret.size() < len) {
+    size_t pos = ret.size();
+    ret += pick(WORDS, sizeof(WORDS) / sizeof(WORDS[0]));
+    ret += ' ';
+
+    if (nextLink && pos >= nextLink) {
+      link(&ret);
+      ret += ' ';
+      nextLink = pos + distance(_opts.linkEvery);
+    }
+    if (nextTmpl && pos >= nextTmpl) {
+      tmpl(&ret);
+      ret += ' ';
+      nextTmpl = pos + distance(_opts.templateEvery);
+    }
+    if (nextEntity && pos >= nextEntity) {
+      entity(&ret);
+      ret += ' ';
+      nextEntity = pos + distance(_opts.entityEvery);
+    }
+    if (pos >= nextPara) {
+      ret += "\n\n";
+      // tables only start at the beginning of a line
+      if (nextTable && pos >= nextTable) {
+        table(&ret);
+        ret += '\n';
+        nextTable = pos + distance(_opts.tableEvery);
+      }
+      if (++paras % 3 == 0) {
+        ret += "== ";
+        ret += pick(SECTIONS, sizeof(SECTIONS) / sizeof(SECTIONS[0]));
+        ret += " ==\n";
+      }
+      nextPara = pos + distance(500);
+    }
+  }
+
+  return ret + "\n\n[[Category:Cities in Baden-Württemberg]]\n";
+}
+
+// _____________________________________________________________________________
+void DumpGen::escape(const std::string& str, std::ostream* out) {
+  for (char c : str) {
+    switch (c) {
+      case '&':
+        *out << "&amp;";
+        break;
+      case '<':
+        *out << "&lt;";
+        break;
+      case '>':
+        *out << "&gt;";
+        break;
+      case '"':
+        *out << "&quot;";
+        break;
+      default:
+        *out << c;
+    }
+  }
+}
+
+// _____________________________________________________________________________
+void DumpGen::dump(std::ostream* out) {
+  *out << "<mediawiki xmlns=\"http://www.mediawiki.org/xml/export-0.10/\" "
+          "xml:lang=\"en\">\n  <siteinfo>\n    <sitename>Wikipedia</sitename>"
+          "\n    <namespaces>\n"
+          "      <namespace key=\"0\" case=\"first-letter\" />\n"
+          "      <namespace key=\"1\" case=\"first-letter\">Talk</namespace>\n"
+          "      <namespace key=\"10\" case=\"first-letter\">Template"
+          "</namespace>\n    </namespaces>\n  </siteinfo>\n";
+
+  for (size_t i = 0; i < _opts.pages; i++) {
+    std::string title = "Freiburg " + std::to_string(i);
+    std::string text;
+    int ns = 0;
+    bool redirect = i % 10 == 9;
+
+    if (redirect) {
+      text = "#REDIRECT [[Freiburg " + std::to_string(i - 1) + "]]";
+    } else if (i % 20 == 4) {
+      ns = 1;
+      title = "Talk:" + title;
+      text = "== Lead ==\nThe lead is too short. ~~~~";
+    } else if (i % 20 == 14) {
+      ns = 10;
+      title = "Template:" + title;
+      text = "<includeonly>{{{1|}}}</includeonly><noinclude>Doc</noinclude>";
+    } else {
+      text = article();
+    }
+
+    *out << "  <page>\n    <title>";
+    escape(title, out);
+    *out << "</title>\n    <ns>" << ns << "</ns>\n    <id>" << i + 1
+         << "</id>\n";
+    if (redirect) {
+      *out << "    <redirect title=\"Freiburg " << i - 1 << "\" />\n";
+    }
+    *out << "    <revision>\n      <id>" << 1000000 + i
+         << "</id>\n      <timestamp>2019-05-01T00:00:00Z</timestamp>\n"
+         << "      <contributor>\n        <username>Someone</username>\n"
+         << "        <id>42</id>\n      </contributor>\n"
+         << "      <comment>copyedit</comment>\n"
+         << "      <model>wikitext</model>\n"
+         << "      <format>text/x-wiki</format>\n"
+         << "      <text bytes=\"" << text.size()
+         << "\" xml:space=\"preserve\">";
+    escape(text, out);
+    *out << "</text>\n      <sha1>0123456789abcdefghijklmnopqrstu</sha1>\n"
+         << "    </revision>\n  </page>\n";
+  }
+
+  *out << "</mediawiki>\n";
+}
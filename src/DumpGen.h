@@ -0,0 +1,63 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#ifndef DUMPGEN_H_
+#define DUMPGEN_H_
+
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <string>
+
+// parameters of a synthetic dump. The distances between the markup
+// constructs are averages in bytes of article text, 0 means none.
+struct DumpGenOpts {
+  DumpGenOpts()
+      : pages(10000),
+        articleBytes(4000),
+        linkEvery(80),
+        templateEvery(400),
+        tableEvery(4000),
+        entityEvery(300),
+        seed(42) {}
+  size_t pages;
+  // average size of the wikitext of an article
+  size_t articleBytes;
+  size_t linkEvery;
+  size_t templateEvery;
+  size_t tableEvery;
+  size_t entityEvery;
+  uint32_t seed;
+};
+
+// generates MediaWiki XML dumps with articles of random prose and markup,
+// the same options always give the same dump. Every 10th page is a
+// redirect, every 20th is a talk page and every 20th a template.
+class DumpGen {
+ public:
+  explicit DumpGen(const DumpGenOpts& opts);
+
+  // write the whole dump, including the <siteinfo>
+  void dump(std::ostream* out);
+
+  // the wikitext of an article, not yet XML-escaped
+  std::string article();
+
+ private:
+  DumpGenOpts _opts;
+  std::mt19937 _rng;
+
+  // a random distance around the average every, 0 if every is 0
+  size_t distance(size_t every);
+  const char* pick(const char* const* items, size_t n);
+
+  void link(std::string* out);
+  void tmpl(std::string* out);
+  void table(std::string* out);
+  void entity(std::string* out);
+
+  static void escape(const std::string& str, std::ostream* out);
+};
+
+#endif  // DUMPGEN_H_
@@ -0,0 +1,75 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "DumpGen.h"
+
+// _____________________________________________________________________________
+void printUsage(const char* bin) {
+  DumpGenOpts def;
+  std::cout << "Usage: \n  " << bin << " [options] > dump.xml\n\n"
+            << "Write a synthetic MediaWiki XML dump to stdout.\n\n"
+            << "Options:\n"
+            << "  --pages <N>            number of pages (default: "
+            << def.pages << ")\n"
+            << "  --article-bytes <N>    average article size (default: "
+            << def.articleBytes << ")\n"
+            << "  --link-every <N>       average bytes between links"
+               " (default: "
+            << def.linkEvery << ")\n"
+            << "  --template-every <N>   average bytes between templates"
+               " (default: "
+            << def.templateEvery << ")\n"
+            << "  --table-every <N>      average bytes between tables"
+               " (default: "
+            << def.tableEvery << ")\n"
+            << "  --entity-every <N>     average bytes between entities"
+               " (default: "
+            << def.entityEvery << ")\n"
+            << "  --seed <N>             random seed (default: " << def.seed
+            << ")\n"
+            << "  --help                 show this help\n\n"
+            << "A distance of 0 leaves out the construct." << std::endl;
+}
+
+// _____________________________________________________________________________
+int main(int argc, char** argv) {
+  DumpGenOpts opts;
+
+  for (int i = 1; i < argc; i++) {
+    size_t* opt = 0;
+    if (!strcmp(argv[i], "--help")) {
+      printUsage(argv[0]);
+      return 0;
+    } else if (!strcmp(argv[i], "--pages")) {
+      opt = &opts.pages;
+    } else if (!strcmp(argv[i], "--article-bytes")) {
+      opt = &opts.articleBytes;
+    } else if (!strcmp(argv[i], "--link-every")) {
+      opt = &opts.linkEvery;
+    } else if (!strcmp(argv[i], "--template-every")) {
+      opt = &opts.templateEvery;
+    } else if (!strcmp(argv[i], "--table-every")) {
+      opt = &opts.tableEvery;
+    } else if (!strcmp(argv[i], "--entity-every")) {
+      opt = &opts.entityEvery;
+    } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      opts.seed = strtoul(argv[++i], 0, 10);
+      continue;
+    }
+
+    if (!opt || i + 1 == argc) {
+      std::cerr << "Invalid option '" << argv[i] << "'.\n\n";
+      printUsage(argv[0]);
+      return 1;
+    }
+    *opt = strtoull(argv[++i], 0, 10);
+  }
+
+  std::ios_base::sync_with_stdio(false);
+  DumpGen(opts).dump(&std::cout);
+  return 0;
+}
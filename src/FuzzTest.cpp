@@ -0,0 +1,524 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <bzlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ReferenceParse.h"
+#include "RunStats.h"
+#include "TextScan.h"
+#include "WikiDumpReader.h"
+#include "WikiText.h"
+#include "pfxml.h"
+
+// Differential tests of the fast paths against straightforward reference
+// implementations on random input. Usage: FuzzTest [seed] [iterations]
+
+// pieces of the random texts, XML-escaped as in a dump
+static const char* PIECES[] = {
+    "a", "Freiburg", " ", "  ", "_", "\n", "\n\n", "\t", "[[", "]]", "[", "]",
+    "{{", "}}", "{{{", "}}}", "{|", "|}", "|", "||", "(", ")", "'", "''",
+    "'''", "=", "==", "*", "#", ":", ";", "__TOC__", "#REDIRECT", "File:",
+    "Category:", "http://x.org", "&amp;", "&lt;", "&gt;", "&quot;", "&#39;",
+    "&amp;amp;", "&amp;lt;", "&amp;nbsp;", "&amp;#x41;", "&amp;#8211;", "&#",
+    "&#x", "&#0;", "&#1114111;", "&foo;", "&amp;foo;", "&lt;ref&gt;",
+    "&lt;ref name=&quot;a&quot; /&gt;", "&lt;/ref&gt;", "&lt;!--", "--&gt;",
+    "&lt;br /&gt;", "&lt;math&gt;", "&lt;/math&gt;", "&lt;span&gt;",
+    "&lt;/span&gt;", "lang|de|", "convert|3|km", "as of|2010",
+    "disambiguation", "nowrap|", "ndash", "Ä", "\xe2\x80\x93"};
+
+// _____________________________________________________________________________
+static std::string randomText(std::mt19937* rng, size_t maxPieces) {
+  std::string ret;
+  size_t n = (*rng)() % maxPieces;
+  for (size_t i = 0; i < n; i++) {
+    ret += PIECES[(*rng)() % (sizeof(PIECES) / sizeof(PIECES[0]))];
+  }
+  return ret;
+}
+
+// pieces of texts on which the output was not changed on purpose since the
+// original tool, without any brackets
+static const char* PLAIN_PIECES[] = {
+    "a", "Freiburg", " ", "  ", "_", "\n", "\n\n", "\t", "|", "'", "''",
+    "'''", "=", "==", "*", "#", ":", ";", "__TOC__", "#REDIRECT", "File:",
+    "Category:", "http://x.org", "&amp;", "&lt;", "&gt;", "&quot;", "&#39;",
+    "&amp;amp;", "&amp;lt;", "&amp;nbsp;", "&amp;#x41;", "&amp;#8211;", "&#",
+    "&#x", "&#0;", "&#1114111;", "&foo;", "&amp;foo;", "&lt;ref&gt;",
+    "&lt;ref name=&quot;a&quot; /&gt;", "&lt;/ref&gt;", "&lt;!--", "--&gt;",
+    "&lt;br /&gt;", "&lt;math&gt;", "&lt;/math&gt;", "&lt;span&gt;",
+    "&lt;/span&gt;", "Ä", "\xe2\x80\x93"};
+
+// closers without an opener and tables, only outside of constructs
+static const char* OUTER_PIECES[] = {"]]", "]", "}}", ")", "{|", "|}"};
+
+// templates without a handler, and with one which renders as originally
+static const char* TEMPLATES[] = {"Infobox", "sfn", "cite web", "x", "math",
+                                  "disambiguation"};
+
+// _____________________________________________________________________________
+static std::string randomPlain(std::mt19937* rng, size_t maxPieces,
+                               const char* without) {
+  std::string ret;
+  size_t pieces = sizeof(PLAIN_PIECES) / sizeof(PLAIN_PIECES[0]);
+  size_t n = (*rng)() % maxPieces;
+  while (n) {
+    const char* p = PLAIN_PIECES[(*rng)() % pieces];
+    if (strpbrk(p, without)) continue;
+    ret += p;
+    n--;
+  }
+  return ret;
+}
+
+// _____________________________________________________________________________
+static std::string randomConstruct(std::mt19937* rng, char outer) {
+  // a closed link, bracket or template, nested in the construct opened with
+  // outer, or 0. Only brackets nest into links, and links and templates into
+  // brackets: the output of nested constructs of the same kind, and of the
+  // pieces of links and templates holding nested ones, was changed on
+  // purpose.
+  size_t kind = (*rng)() % 4;
+  if (outer == '[') kind = 3;
+  if (outer == '(') kind = (*rng)() % 3;
+  switch (kind) {
+    case 0: {
+      std::string ret = "[[";
+      for (size_t n = (*rng)() % 4; n; n--) {
+        ret += randomPlain(rng, 4, "");
+        if (!outer && (*rng)() % 3 == 0) ret += randomConstruct(rng, '[');
+      }
+      return ret + "]]";
+    }
+    case 1:
+      return "[" + randomPlain(rng, 6, "") + "]";
+    case 2: {
+      std::string name =
+          TEMPLATES[(*rng)() % (sizeof(TEMPLATES) / sizeof(TEMPLATES[0]))];
+      if (name == "disambiguation") return "{{" + name + "}}";
+      // the original rendered only the text up to a second | or a = of math
+      if (name == "math") return "{{math|" + randomPlain(rng, 6, "|=") + "}}";
+      std::string ret = "{{" + name;
+      for (size_t n = (*rng)() % 4; n; n--) {
+        ret += "|" + randomPlain(rng, 4, "");
+      }
+      return ret + "}}";
+    }
+    default: {
+      std::string ret = "(";
+      for (size_t n = (*rng)() % 4; n; n--) {
+        ret += randomPlain(rng, 4, "");
+        if (!outer && (*rng)() % 3 == 0) ret += randomConstruct(rng, '(');
+      }
+      return ret + ")";
+    }
+  }
+}
+
+// _____________________________________________________________________________
+static std::string randomOriginalText(std::mt19937* rng, size_t maxPieces) {
+  // a text whose abstract is still the one of the original tool
+  std::string ret;
+  size_t n = (*rng)() % maxPieces;
+  for (size_t i = 0; i < n; i++) {
+    size_t kind = (*rng)() % 8;
+    if (kind < 5) {
+      ret += randomPlain(rng, 3, "");
+    } else if (kind < 7) {
+      ret += randomConstruct(rng, 0);
+    } else {
+      ret += OUTER_PIECES[(*rng)() %
+                          (sizeof(OUTER_PIECES) / sizeof(OUTER_PIECES[0]))];
+    }
+  }
+  return ret;
+}
+
+// _____________________________________________________________________________
+static bool fail(const char* check, const std::string& input,
+                 const std::string& expected, const std::string& got) {
+  printf("%s: MISMATCH\nINPUT:    [%s]\nEXPECTED: [%s]\nGOT:      [%s]\n",
+         check, input.c_str(), expected.c_str(), got.c_str());
+  return false;
+}
+
+// _____________________________________________________________________________
+static bool checkAbstract(std::mt19937* rng, size_t iterations,
+                          size_t maxPieces) {
+  // abstract() decodes in a single pass, and parse() takes fast paths
+  // through plain text, tables and templates without a handler. On texts
+  // whose output was not changed on purpose, it must give the output of the
+  // original tool, with every scanner variant.
+  static const char* VARIANTS[] = {"scalar", "sse2", "avx2"};
+  std::string out;
+  for (size_t i = 0; i < iterations; i++) {
+    std::string text = randomOriginalText(rng, maxPieces);
+    std::string ref = reference::abstract(text.c_str());
+    for (const char* v : VARIANTS) {
+      if (!setScanVariant(v)) continue;
+      abstract(text.c_str(), &out);
+      if (out != ref) return fail(v, text, ref, out);
+    }
+  }
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool checkScanVariants(std::mt19937* rng, size_t iterations,
+                              size_t maxPieces) {
+  // on any text, including unclosed and nested constructs, the vectorized
+  // scanners must give the output of the scalar one
+  static const char* VARIANTS[] = {"sse2", "avx2"};
+  std::string ref;
+  std::string out;
+  for (size_t i = 0; i < iterations; i++) {
+    std::string text = randomText(rng, maxPieces);
+    setScanVariant("scalar");
+    abstract(text.c_str(), &ref);
+    for (const char* v : VARIANTS) {
+      if (!setScanVariant(v)) continue;
+      abstract(text.c_str(), &out);
+      if (out != ref) return fail(v, text, ref, out);
+    }
+  }
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool checkPlainRun(std::mt19937* rng, size_t iterations) {
+  // plainRun() must give the run of the scalar scanner from every position,
+  // with the previous character given by prevSpace only
+  static const char* VARIANTS[] = {"sse2", "avx2"};
+  for (size_t i = 0; i < iterations; i++) {
+    std::string text = randomText(rng, 40);
+    for (size_t pos = 0; pos <= text.size(); pos++) {
+      bool prevSpace = (*rng)() % 2;
+      setScanVariant("scalar");
+      size_t ref = plainRun(text.c_str() + pos, prevSpace);
+      for (const char* v : VARIANTS) {
+        if (!setScanVariant(v)) continue;
+        size_t run = plainRun(text.c_str() + pos, prevSpace);
+        if (run != ref) {
+          return fail(v, text.substr(pos), std::to_string(ref),
+                      std::to_string(run));
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool checkTableSkip(std::mt19937* rng, size_t iterations) {
+  // tableRun() must never skip a table delimiter, checked against a
+  // bytewise scan for the first {| or |}
+  static const char* VARIANTS[] = {"scalar", "sse2", "avx2"};
+  for (size_t i = 0; i < iterations; i++) {
+    std::string text = randomText(rng, 200);
+    size_t first = 0;
+    while (first < text.size() &&
+           !((text[first] == '{' || text[first] == '|') &&
+             text[first + 1] == (text[first] == '{' ? '|' : '}'))) {
+      first++;
+    }
+    for (const char* v : VARIANTS) {
+      if (!setScanVariant(v)) continue;
+      size_t run = tableRun(text.c_str());
+      if (run > first) {
+        return fail(v, text, std::to_string(first), std::to_string(run));
+      }
+    }
+  }
+  return true;
+}
+
+struct Expected {
+  int64_t id;
+  int ns;
+  std::string title;
+  std::string redirect;
+  std::string text;
+};
+
+// _____________________________________________________________________________
+static std::string randomDump(std::mt19937* rng, bool schema,
+                              std::vector<Expected>* expected) {
+  // pages with optional <ns>, redirects and several revisions, with random
+  // metadata. The expected pages are those in the default namespaces.
+  static const int NS[] = {0, 1, 2, 10, 4};
+  static const char* PREFIX[] = {"", "Talk:", "User:", "Template:",
+                                 "Bob&#39;s &amp; co:"};
+  Namespaces used;
+
+  std::stringstream ss;
+  ss << "<mediawiki";
+  if (schema) ss << " xmlns=\"http://www.mediawiki.org/xml/export-0.10/\"";
+  ss << " xml:lang=\"en\">\n<siteinfo>\n<namespaces>\n"
+     << "<namespace key=\"1\">Talk</namespace>\n"
+     << "<namespace key=\"2\">User</namespace>\n"
+     << "<namespace key=\"10\">Template</namespace>\n"
+     << "<namespace key=\"4\">Bob&#39;s &amp; co</namespace>\n"
+     << "</namespaces>\n</siteinfo>\n";
+
+  size_t pages = 1 + (*rng)() % 30;
+  for (size_t p = 0; p < pages; p++) {
+    size_t nsIdx = (*rng)() % 5;
+    std::string title = PREFIX[nsIdx] + std::string("P") + std::to_string(p);
+    if ((*rng)() % 4 == 0) title += " &amp; &quot;x&quot;";
+    std::string redirect = (*rng)() % 5 == 0 ? "Target &amp; co" : "";
+    bool hasNs = (*rng)() % 4 != 0;
+
+    ss << "<page>\n<title>" << title << "</title>\n";
+    if (hasNs) ss << "<ns>" << NS[nsIdx] << "</ns>\n";
+    ss << "<id>" << p + 1 << "</id>\n";
+    if (!redirect.empty()) ss << "<redirect title=\"" << redirect << "\" />\n";
+
+    size_t revisions = 1 + (*rng)() % 3;
+    for (size_t r = 0; r < revisions; r++) {
+      ss << "<revision>\n<id>" << 100 * p + r << "</id>\n";
+      if ((*rng)() % 2) ss << "<parentid>1</parentid>\n";
+      if ((*rng)() % 2) {
+        ss << "<contributor>\n<username>text</username>\n<id>4</id>\n"
+           << "</contributor>\n";
+      }
+      if ((*rng)() % 2) ss << "<minor />\n";
+      if ((*rng)() % 2) {
+        ss << "<comment>&lt;text&gt; in the &lt;revision&gt;</comment>\n";
+      }
+      ss << "<model>wikitext</model>\n";
+
+      std::string text;
+      size_t kind = (*rng)() % 8;
+      if (kind == 0) {
+        ss << "<text deleted=\"deleted\" />\n";
+      } else if (kind == 1) {
+        ss << "<text xml:space=\"preserve\"></text>\n";
+      } else {
+        // leading whitespace of text is not part of it
+        text = "x" + randomText(rng, 20);
+        ss << "<text bytes=\"" << text.size() << "\" xml:space=\"preserve\">"
+           << text << "</text>\n";
+      }
+      if ((*rng)() % 2) ss << "<sha1>abc</sha1>\n";
+      ss << "</revision>\n";
+
+      if (used.use(NS[nsIdx])) {
+        expected->push_back(
+            {static_cast<int64_t>(p + 1), NS[nsIdx], title, redirect, text});
+      }
+    }
+    ss << "</page>\n";
+  }
+  ss << "</mediawiki>\n";
+  return ss.str();
+}
+
+// _____________________________________________________________________________
+static bool checkReader(std::mt19937* rng, size_t iterations) {
+  // the reader skips the revision metadata of dumps following the export
+  // schema, and must return the same pages as it does tag by tag
+  char tpl[] = "/tmp/fuzztest-XXXXXX";
+  int fd = mkstemp(tpl);
+  if (fd < 0) {
+    perror("mkstemp");
+    return false;
+  }
+  close(fd);
+
+  bool ok = true;
+  for (size_t i = 0; ok && i < iterations; i++) {
+    std::vector<Expected> expected;
+    bool schema = i % 2;
+    std::string dump = randomDump(rng, schema, &expected);
+    std::ofstream(tpl) << dump;
+
+    pfxml::file_opts opts;
+    opts.mmap = i % 4 < 2;
+    pfxml::file xml(tpl, opts);
+    WikiDumpReader reader(&xml, Namespaces());
+
+    Page page;
+    size_t n = 0;
+    for (; ok && reader.next(&page); n++) {
+      std::stringstream got;
+      got << page.id << ' ' << page.ns << ' ' << page.title << ' '
+          << page.redirect << ' ' << page.text;
+      std::stringstream exp;
+      if (n < expected.size()) {
+        exp << expected[n].id << ' ' << expected[n].ns << ' '
+            << expected[n].title << ' ' << expected[n].redirect << ' '
+            << expected[n].text;
+      }
+      if (got.str() != exp.str()) {
+        ok = fail("reader", dump, exp.str(), got.str());
+      }
+    }
+    if (ok && n != expected.size()) {
+      ok = fail("reader", dump, std::to_string(expected.size()) + " pages",
+                std::to_string(n) + " pages");
+    }
+  }
+
+  unlink(tpl);
+  return ok;
+}
+
+// _____________________________________________________________________________
+static bool checkCompressedSeek(std::mt19937* rng) {
+  // bzip2 dumps cannot seek, with and without reading ahead the seek must
+  // throw, and the file must still be destroyed cleanly
+  std::vector<Expected> expected;
+  std::string dump = randomDump(rng, true, &expected);
+  std::vector<char> bz(dump.size() + dump.size() / 100 + 600);
+  unsigned int bzLen = bz.size();
+  if (BZ2_bzBuffToBuffCompress(bz.data(), &bzLen, &dump[0], dump.size(), 9, 0,
+                               0) != BZ_OK) {
+    return fail("compressed seek", dump, "compressed", "not compressed");
+  }
+
+  char tpl[] = "/tmp/fuzztest-XXXXXX";
+  int fd = mkstemp(tpl);
+  if (fd < 0) {
+    perror("mkstemp");
+    return false;
+  }
+  bool ok = write(fd, bz.data(), bzLen) == bzLen;
+  close(fd);
+
+  for (size_t readahead = 0; ok && readahead < 2; readahead++) {
+    pfxml::file_opts opts;
+    opts.readahead = readahead;
+    pfxml::file xml(tpl, opts);
+    xml.next();
+    try {
+      xml.seek(dump.size() / 2, "page");
+      ok = fail("compressed seek", dump, "parse_exc", "no exception");
+    } catch (const pfxml::parse_exc& e) {
+    }
+  }
+
+  unlink(tpl);
+  return ok;
+}
+
+// _____________________________________________________________________________
+static bool checkMultistreamError(std::mt19937* rng, size_t iterations) {
+  // a multistream dump with a corrupt stream must deliver all streams before
+  // it and only then fail, however fast the workers are
+  static const size_t STREAMS = 24;
+  char tpl[] = "/tmp/fuzztest-XXXXXX";
+  int fd = mkstemp(tpl);
+  if (fd < 0) {
+    perror("mkstemp");
+    return false;
+  }
+  close(fd);
+  std::string indexPath = std::string(tpl) + "-index.txt";
+
+  bool ok = true;
+  for (size_t i = 0; ok && i < iterations; i++) {
+    size_t bad = 1 + (*rng)() % (STREAMS - 1);
+    std::string bz;
+    std::string expected;
+    std::stringstream index;
+    for (size_t s = 0; s < STREAMS; s++) {
+      // the streams before the corrupt one take longer to decompress
+      std::string text = randomText(rng, s == bad ? 4 : 4000);
+      if (s < bad) expected += text;
+      std::vector<char> out(text.size() + text.size() / 100 + 600);
+      unsigned int outLen = out.size();
+      if (BZ2_bzBuffToBuffCompress(out.data(), &outLen, &text[0], text.size(),
+                                   9, 0, 0) != BZ_OK) {
+        return fail("multistream error", text, "compressed", "not compressed");
+      }
+      // keep the stream header, break the block
+      if (s == bad) memset(out.data() + 4, 0xFF, outLen - 4);
+      index << bz.size() << ":" << s + 1 << ":P" << s << "\n";
+      bz.append(out.data(), outLen);
+    }
+    std::ofstream(tpl) << bz;
+    std::ofstream(indexPath) << index.str();
+
+    std::string got;
+    bool thrown = false;
+    try {
+      pfxml::bz2_multistream_source src(tpl, indexPath, 1 + (*rng)() % 8);
+      char buf[4096];
+      size_t r;
+      while ((r = src.read(buf, sizeof(buf)))) got.append(buf, r);
+    } catch (const pfxml::parse_exc& e) {
+      thrown = true;
+    }
+    if (!thrown) {
+      ok = fail("multistream error", std::to_string(bad), "parse_exc",
+                "no exception");
+    } else if (got != expected) {
+      ok = fail("multistream error", std::to_string(bad),
+                std::to_string(expected.size()) + " bytes",
+                std::to_string(got.size()) + " bytes");
+    }
+  }
+
+  unlink(tpl);
+  unlink(indexPath.c_str());
+  return ok;
+}
+
+// _____________________________________________________________________________
+static bool checkHistogram(std::mt19937* rng, size_t iterations) {
+  // the quantiles of the histogram must be at most 1/16 above the exact ones
+  static const double QS[] = {0.0, 0.25, 0.5, 0.9, 0.99, 0.999, 1.0};
+  for (size_t i = 0; i < iterations; i++) {
+    LatencyHistogram hist;
+    std::vector<uint64_t> values(1 + (*rng)() % 2000);
+    for (auto& v : values) {
+      // spread over all magnitudes
+      v = (static_cast<uint64_t>((*rng)()) << 32 | (*rng)()) >>
+          ((*rng)() % 64);
+      hist.add(v);
+    }
+    std::sort(values.begin(), values.end());
+    for (double q : QS) {
+      size_t rank = std::max<size_t>(1, std::ceil(q * values.size()));
+      uint64_t exact = values[rank - 1];
+      uint64_t got = hist.quantile(q);
+      if (got < exact || got - exact > exact / 16) {
+        return fail("histogram", std::to_string(q), std::to_string(exact),
+                    std::to_string(got));
+      }
+    }
+  }
+  return true;
+}
+
+// _____________________________________________________________________________
+int main(int argc, char** argv) {
+  std::mt19937 rng(argc > 1 ? atoi(argv[1]) : 42);
+  size_t iterations = argc > 2 ? atoi(argv[2]) : 20000;
+
+  // short texts, and long ones with several paragraphs and restarts after
+  // unclosed constructs
+  bool ok = checkAbstract(&rng, iterations, 20) &&
+            checkAbstract(&rng, iterations / 10, 200) &&
+            checkScanVariants(&rng, iterations, 40) &&
+            checkScanVariants(&rng, iterations / 10, 400) &&
+            checkPlainRun(&rng, iterations / 10) &&
+            checkTableSkip(&rng, iterations) &&
+            checkReader(&rng, iterations / 20) &&
+            checkCompressedSeek(&rng) &&
+            checkMultistreamError(&rng, 10) &&
+            checkHistogram(&rng, iterations / 20);
+
+  printf("%s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
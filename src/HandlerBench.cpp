@@ -0,0 +1,83 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include "WikiText.h"
+
+// every handler is called this often per measurement
+static const size_t CALLS = 1000000;
+
+// number of heap allocations made by this process
+static size_t allocs = 0;
+
+// _____________________________________________________________________________
+void* operator new(size_t size) {
+  allocs++;
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+// _____________________________________________________________________________
+void operator delete(void* p) noexcept { free(p); }
+
+// _____________________________________________________________________________
+template <typename F>
+void bench(const char* name, F handler) {
+  // print the time and the number of heap allocations per call of handler,
+  // after a warm-up call which may fill the reused buffers
+  std::string out;
+  handler(&out);
+
+  size_t before = allocs;
+  auto t = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < CALLS; i++) {
+    out.clear();
+    handler(&out);
+  }
+  double s = std::chrono::duration<double>(
+                 std::chrono::steady_clock::now() - t).count();
+
+  printf("%-48s %10.1f %14.3f\n", name, s / CALLS * 1e9,
+         static_cast<double>(allocs - before) / CALLS);
+}
+
+// _____________________________________________________________________________
+int main() {
+  printf("%-48s %10s %14s\n", "handler", "ns / call", "allocs / call");
+
+  bench("parseSq([[Freiburg im Breisgau]])", [](std::string* out) {
+    parseSq("Freiburg im Breisgau", out);
+  });
+  bench("parseSq([[Freiburg im Breisgau|Freiburg]])", [](std::string* out) {
+    parseSq("Freiburg im Breisgau|Freiburg", out);
+  });
+  bench("parseSq([[Freiburg, Germany]])", [](std::string* out) {
+    parseSq("Freiburg, Germany", out);
+  });
+  bench("parseSq([[File:Freiburg.jpg|thumb|Freiburg]])", [](std::string* out) {
+    parseSq("File:Freiburg.jpg|thumb|Freiburg", out);
+  });
+  bench("parseSSq([http://freiburg.de Freiburg])", [](std::string* out) {
+    parseSSq("http://freiburg.de Freiburg", out);
+  });
+  bench("parseCrl({{math|x^2 + y^2}})", [](std::string* out) {
+    parseCrl("math|x^2 + y^2", out);
+  });
+  bench("parseCrl({{Infobox settlement|name=Freiburg}})",
+        [](std::string* out) {
+          parseCrl("Infobox settlement|name=Freiburg", out);
+        });
+  bench("parse() of a sentence with 4 links", [](std::string* out) {
+    parse("'''Freiburg''' is a [[city]] in [[Baden-Württemberg|BW]], "
+          "[[Germany]], near the [[Black Forest]].",
+          10, true, out);
+  });
+
+  return 0;
+}
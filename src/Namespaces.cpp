@@ -0,0 +1,106 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <cstring>
+#include "Namespaces.h"
+#include "pfxml.h"
+
+// namespaces which are dropped by default
+static const std::pair<int, const char*> DROP_NS[] = {
+    {2, "User"},
+    {4, "Wikipedia"},
+    {6, "File"},
+    {8, "MediaWiki"},
+    {10, "Template"},
+    {12, "Help"},
+    {14, "Category"},
+    {100, "Portal"},
+    {108, "Book"},
+    {118, "Draft"},
+    {710, "TimedText"},
+    {828, "Module"},
+    {446, "Education Program"},
+    {2300, "Gadget"},
+    {2302, "Gadget definition"},
+    {-1, "Special"},
+    {-2, "Media"}
+};
+
+// _____________________________________________________________________________
+Namespaces::Namespaces() : _useOther(true) {
+  for (const auto& ns : DROP_NS) {
+    drop(ns.first);
+    _ids[ns.second] = ns.first;
+  }
+}
+
+// _____________________________________________________________________________
+void Namespaces::read(pfxml::file* xml) {
+  // <siteinfo><namespaces><namespace key="2">User</namespace>...
+
+  if (xml->level() != 2 || strcmp(xml->get().name, "siteinfo") != 0) return;
+
+  bool inNs = false;
+  int id = 0;
+
+  while (xml->next()) {
+    const auto& cur = xml->get();
+    if (xml->level() <= 2) return;
+
+    if (xml->level() == 4 && strcmp(cur.name, "namespace") == 0) {
+      inNs = false;
+      for (const auto& attr : cur.attrs) {
+        if (strcmp(attr.first, "key") == 0) {
+          id = atoi(attr.second);
+          inNs = true;
+        }
+      }
+    } else if (inNs && xml->level() == 5 && !cur.name[0]) {
+      _ids[pfxml::file::decode(cur.text)] = id;
+      inNs = false;
+    } else {
+      inNs = false;
+    }
+  }
+}
+
+// _____________________________________________________________________________
+void Namespaces::useOnly(const std::vector<int>& ids) {
+  _use.assign(_use.size(), false);
+  _useOther = false;
+  for (int id : ids) {
+    if (id < MIN_NS) continue;
+    size_t i = id - MIN_NS;
+    if (i >= _use.size()) _use.resize(i + 1, _useOther);
+    _use[i] = true;
+  }
+}
+
+// _____________________________________________________________________________
+void Namespaces::drop(int id) {
+  if (id < MIN_NS) return;
+  size_t i = id - MIN_NS;
+  if (i >= _use.size()) _use.resize(i + 1, _useOther);
+  _use[i] = false;
+}
+
+// _____________________________________________________________________________
+bool Namespaces::use(int id) const {
+  if (id < MIN_NS) return _useOther;
+  size_t i = id - MIN_NS;
+  if (i >= _use.size()) return _useOther;
+  return _use[i];
+}
+
+// _____________________________________________________________________________
+int Namespaces::id(const std::string& title) const {
+  // the names are stored decoded, the title is not
+  auto nsPos = title.find(':');
+  if (nsPos != std::string::npos) {
+    auto it = _ids.find(pfxml::file::decode(title.substr(0, nsPos)));
+    if (it != _ids.end()) return it->second;
+  }
+  // main namespace
+  return 0;
+}
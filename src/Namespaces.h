@@ -0,0 +1,56 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#ifndef NAMESPACES_H_
+#define NAMESPACES_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pfxml {
+class file;
+}
+
+// smallest namespace id, -2 is "Media", -1 is "Special"
+static const int MIN_NS = -2;
+// largest namespace id, those of extensions are in the thousands
+static const int MAX_NS = 65535;
+
+// the namespaces of a wiki and which of them are used. Pages are filtered
+// by the numeric <ns> of the page, the namespace names are only needed for
+// dumps without <ns> elements, where the namespace is the title prefix.
+class Namespaces {
+ public:
+  // the namespaces of the English Wikipedia, everything but articles, talk
+  // pages and a few others is dropped
+  Namespaces();
+
+  // read the namespace names from the <siteinfo> of a dump, if xml is
+  // positioned on it. Afterwards, xml is positioned on the element following
+  // it, usually the first <page>.
+  void read(pfxml::file* xml);
+
+  // use only the namespaces ids
+  void useOnly(const std::vector<int>& ids);
+
+  // drop the namespace id
+  void drop(int id);
+
+  bool use(int id) const;
+
+  // the id of the namespace the XML-escaped page title is prefixed by, 0 if
+  // none
+  int id(const std::string& title) const;
+
+ private:
+  // bitmap of used namespaces, indexed by id - MIN_NS
+  std::vector<bool> _use;
+  // for ids beyond _use
+  bool _useOther;
+
+  std::unordered_map<std::string, int> _ids;
+};
+
+#endif  // NAMESPACES_H_
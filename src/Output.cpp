@@ -0,0 +1,87 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <errno.h>
+#include <unistd.h>
+#include <cstring>
+#include "Output.h"
+
+// _____________________________________________________________________________
+Output::Output(int fd, size_t bufSize, size_t flushEvery)
+    : _fd(fd),
+      _buf(new char[bufSize]),
+      _size(bufSize),
+      _pos(0),
+      _flushEvery(flushEvery),
+      _pages(0),
+      _good(true) {}
+
+// _____________________________________________________________________________
+Output::~Output() {
+  flush();
+  delete[] _buf;
+}
+
+// _____________________________________________________________________________
+void Output::write(const std::string& str) { write(str.data(), str.size()); }
+
+// _____________________________________________________________________________
+void Output::write(const char* data, size_t len) {
+  if (_pos + len > _size) {
+    flush();
+    // too large for the buffer, write directly
+    if (len > _size) return writeOut(data, len);
+  }
+
+  memcpy(_buf + _pos, data, len);
+  _pos += len;
+}
+
+// _____________________________________________________________________________
+void Output::pagesDone(size_t n) {
+  if (!_flushEvery) return;
+  _pages += n;
+  if (_pages >= _flushEvery) {
+    flush();
+    _pages = 0;
+  }
+}
+
+// _____________________________________________________________________________
+void Output::flush() {
+  writeOut(_buf, _pos);
+  _pos = 0;
+}
+
+// _____________________________________________________________________________
+void Output::copy(int fd) {
+  flush();
+  while (_good) {
+    ssize_t r = read(fd, _buf, _size);
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      _good = false;
+      return;
+    }
+    if (r == 0) return;
+    writeOut(_buf, r);
+  }
+}
+
+// _____________________________________________________________________________
+bool Output::good() const { return _good; }
+
+// _____________________________________________________________________________
+void Output::writeOut(const char* data, size_t len) {
+  while (_good && len) {
+    ssize_t r = ::write(_fd, data, len);
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      _good = false;
+      return;
+    }
+    data += r;
+    len -= r;
+  }
+}
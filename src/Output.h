@@ -0,0 +1,48 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <string>
+
+// default size of the output buffer
+static const size_t OUTPUT_BUFFER_S = 16 * 1024 * 1024;
+
+// buffered writer to a file descriptor, the buffer is only written out
+// when it is full, every flushEvery pages, and on flush() / destruction
+class Output {
+ public:
+  Output(int fd, size_t bufSize, size_t flushEvery);
+  ~Output();
+
+  void write(const char* data, size_t len);
+  void write(const std::string& str);
+
+  // signal that the output of n pages was written
+  void pagesDone(size_t n);
+
+  void flush();
+
+  // append the content of the file fd, a failed read counts as a failed write
+  void copy(int fd);
+
+  // false if a write failed, all following output is dropped
+  bool good() const;
+
+ private:
+  int _fd;
+  char* _buf;
+  size_t _size;
+  size_t _pos;
+
+  size_t _flushEvery;
+  size_t _pages;
+
+  bool _good;
+
+  void writeOut(const char* data, size_t len);
+};
+
+#endif  // OUTPUT_H_
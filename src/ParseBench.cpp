@@ -0,0 +1,79 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include "TextScan.h"
+#include "WikiText.h"
+
+// size of the parsed test text
+static const size_t TEXT_S = 16 * 1024 * 1024;
+
+// the text is parsed this often, the best run is reported
+static const size_t RUNS = 5;
+
+// _____________________________________________________________________________
+std::string genText(size_t markupEvery, std::mt19937* rng) {
+  // a single paragraph of prose with a link after every markupEvery bytes
+  // on average, parse() scans all of it
+  static const char* WORDS[] = {"the", "of", "Freiburg", "is", "a", "city",
+                                "in", "Baden-Württemberg,", "Germany.",
+                                "located", "on", "river", "Dreisam"};
+
+  std::string ret;
+  size_t sinceMarkup = 0;
+  while (ret.size() < TEXT_S) {
+    if (sinceMarkup >= markupEvery) {
+      ret += "[[Black Forest|Schwarzwald]]";
+      sinceMarkup = 0;
+    } else {
+      std::string w = WORDS[(*rng)() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+      ret += w;
+      sinceMarkup += w.size() + 1;
+    }
+    ret += ' ';
+  }
+  return ret;
+}
+
+// _____________________________________________________________________________
+double bench(const std::string& text) {
+  // returns the best throughput of parse() on text in MB/s
+  double best = 0;
+  std::string out;
+  for (size_t r = 0; r < RUNS; r++) {
+    auto t = std::chrono::steady_clock::now();
+    parse(text.c_str(), 10, true, &out);
+    double s = std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - t).count();
+    best = std::max(best, text.size() / s / (1024 * 1024));
+  }
+  return best;
+}
+
+// _____________________________________________________________________________
+int main() {
+  std::mt19937 rng(42);
+
+  printf("parse() throughput in MB/s, default scanner: %s\n", scanVariant());
+  printf("%-22s %10s %10s %10s\n", "link every (bytes)", "scalar", "sse2",
+         "avx2");
+
+  for (size_t every : {100000, 1000, 100}) {
+    std::string text = genText(every, &rng);
+    printf("%-22zu", every);
+    for (const char* v : {"scalar", "sse2", "avx2"}) {
+      if (setScanVariant(v)) {
+        printf(" %10.1f", bench(text));
+      } else {
+        printf(" %10s", "-");
+      }
+    }
+    printf("\n");
+  }
+
+  return 0;
+}
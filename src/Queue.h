@@ -0,0 +1,56 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#ifndef QUEUE_H_
+#define QUEUE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// simple blocking multi-producer, multi-consumer FIFO queue
+template <typename T>
+class Queue {
+ public:
+  Queue() : _closed(false) {}
+
+  // ___________________________________________________________________________
+  void push(const T& t) {
+    {
+      std::unique_lock<std::mutex> lock(_m);
+      _q.push_back(t);
+    }
+    _cv.notify_one();
+  }
+
+  // ___________________________________________________________________________
+  bool pop(T* t) {
+    // blocks until an element is available, returns false if the queue
+    // was closed and is empty
+
+    std::unique_lock<std::mutex> lock(_m);
+    _cv.wait(lock, [this] { return _closed || !_q.empty(); });
+    if (_q.empty()) return false;
+    *t = _q.front();
+    _q.pop_front();
+    return true;
+  }
+
+  // ___________________________________________________________________________
+  void close() {
+    {
+      std::unique_lock<std::mutex> lock(_m);
+      _closed = true;
+    }
+    _cv.notify_all();
+  }
+
+ private:
+  std::deque<T> _q;
+  bool _closed;
+  std::mutex _m;
+  std::condition_variable _cv;
+};
+
+#endif  // QUEUE_H_
@@ -0,0 +1,31 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#ifndef REFERENCEPARSE_H_
+#define REFERENCEPARSE_H_
+
+#include <string>
+
+// The wikitext parser and entity decoder of the original WikiAbstractsMain,
+// as the oracle the parser of WikiText is tested against. It shares no code
+// with the tool, and is changed only where the original read out of bounds:
+// at a trailing space on an empty output, and after an unclosed closing tag
+// at the end of the text.
+//
+// The output of the tool was changed on purpose since for templates with
+// handlers, nested links, brackets and templates of the same kind, pieces
+// of links and templates holding nested ones, and unclosed constructs. It
+// can only be compared on texts without these. Only linked into the tests.
+namespace reference {
+
+std::string parse(const char* text, size_t maxParas, bool woBr);
+
+std::string decode(const char* str);
+
+// parse, decode two times and parse again
+std::string abstract(const char* text);
+
+}  // namespace reference
+
+#endif  // REFERENCEPARSE_H_
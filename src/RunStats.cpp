@@ -0,0 +1,275 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include "RunStats.h"
+#include "pfxml.h"
+
+// the percentiles reported of the page times
+static const double PERCENTILES[] = {0.5, 0.9, 0.99, 0.999};
+static const char* PERCENTILE_NAMES[] = {"p50", "p90", "p99", "p99.9"};
+
+// _____________________________________________________________________________
+LatencyHistogram::LatencyHistogram() : _max(0) {
+  for (auto& b : _buckets) b = 0;
+}
+
+// _____________________________________________________________________________
+size_t LatencyHistogram::bucket(uint64_t ns) {
+  // values below 2^HIST_SUB_BITS have a bucket of their own, above, the
+  // bucket is given by the position of the highest bit and the HIST_SUB_BITS
+  // bits following it
+  if (ns < (1ull << HIST_SUB_BITS)) return ns;
+  size_t high = 63 - __builtin_clzll(ns);
+  size_t shift = high - HIST_SUB_BITS;
+  return ((shift + 1) << HIST_SUB_BITS) +
+         ((ns >> shift) & ((1ull << HIST_SUB_BITS) - 1));
+}
+
+// _____________________________________________________________________________
+uint64_t LatencyHistogram::lowest(size_t bucket) {
+  if (bucket < (1ull << HIST_SUB_BITS)) return bucket;
+  size_t shift = (bucket >> HIST_SUB_BITS) - 1;
+  return ((1ull << HIST_SUB_BITS) + (bucket & ((1ull << HIST_SUB_BITS) - 1)))
+         << shift;
+}
+
+// _____________________________________________________________________________
+void LatencyHistogram::add(uint64_t ns) {
+  _buckets[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+  uint64_t max = _max.load(std::memory_order_relaxed);
+  while (ns > max && !_max.compare_exchange_weak(max, ns)) {
+  }
+}
+
+// _____________________________________________________________________________
+uint64_t LatencyHistogram::count() const {
+  uint64_t ret = 0;
+  for (const auto& b : _buckets) ret += b.load(std::memory_order_relaxed);
+  return ret;
+}
+
+// _____________________________________________________________________________
+uint64_t LatencyHistogram::max() const { return _max; }
+
+// _____________________________________________________________________________
+uint64_t LatencyHistogram::quantile(double q) const {
+  // the highest value of the bucket holding the value at rank q * count
+  uint64_t total = count();
+  if (total == 0) return 0;
+  uint64_t rank = std::max<uint64_t>(1, std::ceil(q * total));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKETS; i++) {
+    seen += _buckets[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      if (i + 1 == BUCKETS) return max();
+      return std::min(max(), lowest(i + 1) - 1);
+    }
+  }
+  return max();
+}
+
+// _____________________________________________________________________________
+SlowestPages::SlowestPages(size_t k) : _k(k), _min(0) {}
+
+// _____________________________________________________________________________
+static bool fasterPage(const SlowPage& a, const SlowPage& b) {
+  return a.ns > b.ns;
+}
+
+// _____________________________________________________________________________
+void SlowestPages::add(uint64_t ns, const char* title, const char* text) {
+  if (_k == 0 || ns <= _min.load(std::memory_order_relaxed)) return;
+
+  std::lock_guard<std::mutex> lock(_m);
+  if (_heap.size() == _k) {
+    if (ns <= _heap.front().ns) return;
+    std::pop_heap(_heap.begin(), _heap.end(), fasterPage);
+    _heap.pop_back();
+  }
+  _heap.push_back({ns, strlen(text), pfxml::file::decode(title)});
+  std::push_heap(_heap.begin(), _heap.end(), fasterPage);
+  if (_heap.size() == _k) _min = _heap.front().ns;
+}
+
+// _____________________________________________________________________________
+std::vector<SlowPage> SlowestPages::get() const {
+  std::lock_guard<std::mutex> lock(_m);
+  std::vector<SlowPage> ret = _heap;
+  std::sort_heap(ret.begin(), ret.end(), fasterPage);
+  return ret;
+}
+
+// _____________________________________________________________________________
+static std::string jsonString(const std::string& str) {
+  std::string ret = "\"";
+  for (unsigned char c : str) {
+    if (c == '"' || c == '\\') {
+      ret += '\\';
+      ret += c;
+    } else if (c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      ret += buf;
+    } else {
+      ret += c;
+    }
+  }
+  return ret + '"';
+}
+
+// _____________________________________________________________________________
+RunStats::RunStats(size_t slowest)
+    : bytes(0),
+      pages(0),
+      emitted(0),
+      skippedNs(0),
+      skippedRedirect(0),
+      skippedDisambiguation(0),
+      skippedEmpty(0),
+      xmlNs(0),
+      parseNs(0),
+      decodeNs(0),
+      outputNs(0),
+      slowest(slowest) {}
+
+// _____________________________________________________________________________
+std::string RunStats::line(double seconds, int64_t totalBytes) const {
+  // [   10 s] 1210.5 MB (27.0%, 121.1 MB/s, ETA 27 s), 352000 pages
+  // (35200/s), 180000 output, skipped: ...
+  char buf[512];
+  double mb = bytes / (1024.0 * 1024.0);
+  double s = seconds > 0 ? seconds : 1e-9;
+  int n = snprintf(buf, sizeof(buf), "[%5.0f s] %.1f MB", seconds, mb);
+
+  if (totalBytes > 0) {
+    double done = std::min(1.0, static_cast<double>(bytes) / totalBytes);
+    n += snprintf(buf + n, sizeof(buf) - n, " (%.1f%%, %.1f MB/s", done * 100,
+                  mb / s);
+    if (done > 0) {
+      n += snprintf(buf + n, sizeof(buf) - n, ", ETA %.0f s",
+                    seconds / done - seconds);
+    }
+    n += snprintf(buf + n, sizeof(buf) - n, ")");
+  } else {
+    n += snprintf(buf + n, sizeof(buf) - n, " (%.1f MB/s)", mb / s);
+  }
+
+  snprintf(buf + n, sizeof(buf) - n,
+           ", %zu pages (%.0f/s), %zu output, skipped: %zu namespace, %zu "
+           "redirect, %zu disambiguation, %zu empty; time: xml %.1f s, parse "
+           "%.1f s, decode %.1f s, output %.1f s",
+           pages.load(), pages / s, emitted.load(), skippedNs.load(),
+           skippedRedirect.load(), skippedDisambiguation.load(),
+           skippedEmpty.load(), xmlNs / 1e9, parseNs / 1e9, decodeNs / 1e9,
+           outputNs / 1e9);
+  return buf;
+}
+
+// _____________________________________________________________________________
+std::string RunStats::latencies() const {
+  // page time (12000 pages): p50 52 us, p90 310 us, ..., max 18012 us
+  //   18012 us   412345 bytes  List of ...
+  char buf[512];
+  int n = snprintf(buf, sizeof(buf), "page time (%llu pages):",
+                   static_cast<unsigned long long>(pageNs.count()));
+  for (size_t i = 0; i < sizeof(PERCENTILES) / sizeof(PERCENTILES[0]); i++) {
+    n += snprintf(buf + n, sizeof(buf) - n, " %s %llu us,", PERCENTILE_NAMES[i],
+                  static_cast<unsigned long long>(
+                      pageNs.quantile(PERCENTILES[i]) / 1000));
+  }
+  snprintf(buf + n, sizeof(buf) - n, " max %llu us",
+           static_cast<unsigned long long>(pageNs.max() / 1000));
+  std::string ret = buf;
+
+  for (const auto& p : slowest.get()) {
+    snprintf(buf, sizeof(buf), "\n  %8llu us %10zu bytes  ",
+             static_cast<unsigned long long>(p.ns / 1000), p.bytes);
+    ret += buf;
+    ret += p.title;
+  }
+  return ret;
+}
+
+// _____________________________________________________________________________
+std::string RunStats::json(double seconds) const {
+  char buf[512];
+  int n = snprintf(buf, sizeof(buf),
+           "{\"seconds\": %.3f, \"bytes\": %lld, \"pages\": %zu, \"output\": "
+           "%zu, \"skipped\": {\"namespace\": %zu, \"redirect\": %zu, "
+           "\"disambiguation\": %zu, \"empty\": %zu}, \"time_s\": {\"xml\": "
+           "%.3f, \"parse\": %.3f, \"decode\": %.3f, \"output\": %.3f}, "
+           "\"page_us\": {",
+           seconds, static_cast<long long>(bytes.load()), pages.load(),
+           emitted.load(), skippedNs.load(), skippedRedirect.load(),
+           skippedDisambiguation.load(), skippedEmpty.load(), xmlNs / 1e9,
+           parseNs / 1e9, decodeNs / 1e9, outputNs / 1e9);
+  for (size_t i = 0; i < sizeof(PERCENTILES) / sizeof(PERCENTILES[0]); i++) {
+    n += snprintf(buf + n, sizeof(buf) - n, "\"%s\": %llu, ",
+                  PERCENTILE_NAMES[i],
+                  static_cast<unsigned long long>(
+                      pageNs.quantile(PERCENTILES[i]) / 1000));
+  }
+  snprintf(buf + n, sizeof(buf) - n, "\"max\": %llu}, \"slowest\": [",
+           static_cast<unsigned long long>(pageNs.max() / 1000));
+  std::string ret = buf;
+
+  std::vector<SlowPage> pages = slowest.get();
+  for (size_t i = 0; i < pages.size(); i++) {
+    snprintf(buf, sizeof(buf), "%s{\"us\": %llu, \"bytes\": %zu, \"title\": ",
+             i ? ", " : "", static_cast<unsigned long long>(pages[i].ns / 1000),
+             pages[i].bytes);
+    ret += buf;
+    ret += jsonString(pages[i].title) + "}";
+  }
+  return ret + "]}";
+}
+
+// _____________________________________________________________________________
+uint64_t nsSince(std::chrono::steady_clock::time_point* t) {
+  auto now = std::chrono::steady_clock::now();
+  uint64_t ret =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now - *t).count();
+  *t = now;
+  return ret;
+}
+
+// _____________________________________________________________________________
+ProgressReporter::ProgressReporter(const RunStats* stats, int64_t totalBytes)
+    : _stats(stats),
+      _totalBytes(totalBytes),
+      _start(std::chrono::steady_clock::now()),
+      _stop(false) {
+  _thread = std::thread([this]() {
+    std::unique_lock<std::mutex> lock(_m);
+    while (!_cv.wait_for(lock, std::chrono::seconds(PROGRESS_INTERVAL_S),
+                         [this]() { return _stop; })) {
+      std::cerr << _stats->line(seconds(), _totalBytes) << std::endl;
+    }
+  });
+}
+
+// _____________________________________________________________________________
+ProgressReporter::~ProgressReporter() {
+  {
+    std::lock_guard<std::mutex> lock(_m);
+    _stop = true;
+  }
+  _cv.notify_one();
+  _thread.join();
+
+  std::cerr << _stats->line(seconds(), _totalBytes) << std::endl;
+  std::cerr << _stats->latencies() << std::endl;
+  std::cerr << _stats->json(seconds()) << std::endl;
+}
+
+// _____________________________________________________________________________
+double ProgressReporter::seconds() const {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       _start).count();
+}
@@ -0,0 +1,141 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#ifndef RUNSTATS_H_
+#define RUNSTATS_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// seconds between two progress reports
+static const size_t PROGRESS_INTERVAL_S = 10;
+
+// default number of slowest pages reported
+static const size_t SLOWEST_PAGES = 10;
+
+// histogram of latencies in nanoseconds with logarithmic buckets as in HDR
+// histograms: each power of two is split into 2^HIST_SUB_BITS buckets, so
+// values are recorded with a relative error below 1/16. Adding a value is a
+// single atomic increment.
+static const size_t HIST_SUB_BITS = 4;
+
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  void add(uint64_t ns);
+
+  // the smallest recorded value (up to the bucket precision) which is not
+  // smaller than the fraction q of all recorded values
+  uint64_t quantile(double q) const;
+
+  uint64_t count() const;
+  uint64_t max() const;
+
+ private:
+  static const size_t BUCKETS = (64 - HIST_SUB_BITS + 1) << HIST_SUB_BITS;
+  std::atomic<uint64_t> _buckets[BUCKETS];
+  std::atomic<uint64_t> _max;
+
+  static size_t bucket(uint64_t ns);
+  static uint64_t lowest(size_t bucket);
+};
+
+struct SlowPage {
+  uint64_t ns;
+  size_t bytes;
+  // the decoded title
+  std::string title;
+};
+
+// the k pages which took longest. Pages faster than the k-th slowest so far
+// are rejected without locking.
+class SlowestPages {
+ public:
+  explicit SlowestPages(size_t k);
+
+  // title is XML-encoded
+  void add(uint64_t ns, const char* title, const char* text);
+
+  // the slowest page first
+  std::vector<SlowPage> get() const;
+
+ private:
+  size_t _k;
+  std::atomic<uint64_t> _min;
+
+  mutable std::mutex _m;
+  // a min-heap on the time
+  std::vector<SlowPage> _heap;
+};
+
+// counters of a run, updated by the reading and the parser threads. Times
+// are summed over all threads.
+struct RunStats {
+  // the slowest pages are collected
+  explicit RunStats(size_t slowest);
+
+  // input bytes read or skipped
+  std::atomic<int64_t> bytes;
+
+  // <page> elements read, and pages output
+  std::atomic<size_t> pages;
+  std::atomic<size_t> emitted;
+
+  // pages not output, by reason. Pages with several revisions count once
+  // per revision.
+  std::atomic<size_t> skippedNs;
+  std::atomic<size_t> skippedRedirect;
+  std::atomic<size_t> skippedDisambiguation;
+  std::atomic<size_t> skippedEmpty;
+
+  std::atomic<uint64_t> xmlNs;
+  std::atomic<uint64_t> parseNs;
+  std::atomic<uint64_t> decodeNs;
+  std::atomic<uint64_t> outputNs;
+
+  // time of abstract() per page, without the pages skipped by namespace
+  LatencyHistogram pageNs;
+  SlowestPages slowest;
+
+  // a line for humans, totalBytes is -1 if unknown
+  std::string line(double seconds, int64_t totalBytes) const;
+
+  // the page time percentiles and the slowest pages, one per line
+  std::string latencies() const;
+
+  // a single line of JSON
+  std::string json(double seconds) const;
+};
+
+// nanoseconds since t, t is set to now
+uint64_t nsSince(std::chrono::steady_clock::time_point* t);
+
+// writes the stats to stderr every PROGRESS_INTERVAL_S seconds, and a
+// summary when it is destroyed
+class ProgressReporter {
+ public:
+  ProgressReporter(const RunStats* stats, int64_t totalBytes);
+  ~ProgressReporter();
+
+ private:
+  const RunStats* _stats;
+  int64_t _totalBytes;
+  std::chrono::steady_clock::time_point _start;
+
+  std::mutex _m;
+  std::condition_variable _cv;
+  bool _stop;
+  std::thread _thread;
+
+  double seconds() const;
+};
+
+#endif  // RUNSTATS_H_
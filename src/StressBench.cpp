@@ -0,0 +1,120 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "WikiText.h"
+
+// Adversarial articles of growing size, to check that abstract() takes time
+// linear in the article size. For each input, the time per byte is printed
+// for every size, it must not grow with the size.
+
+// the sizes of the articles
+static const size_t SIZES[] = {16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024,
+                               4 * 1024 * 1024};
+
+// larger sizes are not measured once a single run took longer than this
+static const double MAX_RUN_S = 5;
+
+// every measurement is repeated this often, the best run is reported
+static const size_t RUNS = 3;
+
+// _____________________________________________________________________________
+static std::string repeat(const char* str, size_t bytes) {
+  std::string ret;
+  while (ret.size() < bytes) ret += str;
+  return ret;
+}
+
+// _____________________________________________________________________________
+static std::string nested(const char* open, const char* close, size_t bytes) {
+  // open and close, nested until the text has the given size
+  size_t n = bytes / (strlen(open) + strlen(close));
+  std::string ret;
+  for (size_t i = 0; i < n; i++) ret += open;
+  ret += "x";
+  for (size_t i = 0; i < n; i++) ret += close;
+  return ret;
+}
+
+struct Input {
+  const char* name;
+  std::string (*gen)(size_t bytes);
+};
+
+static const Input INPUTS[] = {
+    {"unclosed (", [](size_t b) { return "a " + repeat("(b c ", b); }},
+    {"unclosed [[", [](size_t b) { return "a " + repeat("[[b c ", b); }},
+    {"unclosed [", [](size_t b) { return "a " + repeat("[b c ", b); }},
+    {"unclosed {{", [](size_t b) { return "a " + repeat("{{b c ", b); }},
+    {"unclosed {{ in {{",
+     [](size_t b) { return "a {{b " + repeat("{{c}} {{d ", b); }},
+    {"unclosed {{ per line",
+     [](size_t b) { return "a " + repeat("{{b c\n| d\ne ", b); }},
+    {"nested (", [](size_t b) { return nested("(a ", ") b", b); }},
+    {"nested ( (decoded)",
+     [](size_t b) { return nested("&#40;a ", "&#41; b", b); }},
+    {"nested [[", [](size_t b) { return nested("[[a ", "]] b", b); }},
+    {"nested [", [](size_t b) { return nested("[a ", "] b", b); }},
+    {"nested templates",
+     [](size_t b) { return nested("{{lang|de|a ", "}} b", b); }},
+    {"links in a link",
+     [](size_t b) { return "[[a|" + repeat("b [[c]] ", b) + "]]"; }},
+    {"brackets in a bracket (decoded)",
+     [](size_t b) {
+       return "&#40;a " + repeat("b &#40;c&#41; ", b) + "&#41;";
+     }},
+    {"< without >", [](size_t b) { return repeat("a < b ", b); }},
+    {"closing tags in a tag",
+     [](size_t b) { return "<ref>" + repeat("a </b> ", b) + "</ref>"; }}};
+
+// _____________________________________________________________________________
+static double nsPerByte(const std::string& text, double* runS) {
+  // the best time of abstract() on text, per byte
+  std::string out;
+  double best = 1e300;
+  for (size_t r = 0; r < RUNS && (r == 0 || best < MAX_RUN_S * 1e9); r++) {
+    auto t = std::chrono::steady_clock::now();
+    abstract(text.c_str(), &out);
+    best = std::min(best, std::chrono::duration<double, std::nano>(
+                              std::chrono::steady_clock::now() - t).count());
+  }
+  *runS = best / 1e9;
+  return best / text.size();
+}
+
+// _____________________________________________________________________________
+int main() {
+  printf("abstract() time in ns per byte, by article size in KB\n");
+  printf("%-32s", "");
+  for (size_t s : SIZES) printf(" %8zu", s / 1024);
+  printf(" %8s\n", "growth");
+
+  for (const auto& in : INPUTS) {
+    printf("%-32s", in.name);
+    double prev = 0;
+    double last = 0;
+    bool slow = false;
+    for (size_t s : SIZES) {
+      if (slow) {
+        printf(" %8s", "-");
+        continue;
+      }
+      double runS;
+      prev = last;
+      last = nsPerByte(in.gen(s), &runS);
+      printf(" %8.1f", last);
+      fflush(stdout);
+      slow = runS > MAX_RUN_S;
+    }
+    // the time per byte of the largest measured size relative to the size
+    // before, about 1 if the time is linear and 4 if it is quadratic
+    printf(" %8.1f\n", prev ? last / prev : 1);
+  }
+
+  return 0;
+}
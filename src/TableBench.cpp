@@ -0,0 +1,164 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "TextScan.h"
+#include "WikiText.h"
+
+// number of generated articles
+static const size_t ARTICLES = 2000;
+
+// each measurement is repeated this often, the best run is reported
+static const size_t RUNS = 5;
+
+// keeps the skipping loops from being optimized away
+static volatile size_t sink = 0;
+
+// _____________________________________________________________________________
+static std::string genTable(std::mt19937* rng) {
+  // a league table or election results, with a nested table in some cells
+  static const char* CELLS[] = {"[[SC Freiburg]]", "34", "{{flagicon|GER}}",
+                                "60:30", "''68''", "[[Black Forest|BF]]",
+                                "12.5%", "style=\"text-align:right\" | 1,024"};
+  std::string ret = "{| class=\"wikitable sortable\"\n! Pos !! Team !! Pld "
+                    "!! W !! D !! L !! GD !! Pts\n";
+  size_t rows = 10 + (*rng)() % 40;
+  for (size_t r = 0; r < rows; r++) {
+    ret += "|-\n| " + std::to_string(r + 1);
+    for (size_t c = 0; c < 8; c++) {
+      ret += " || ";
+      ret += CELLS[(*rng)() % (sizeof(CELLS) / sizeof(CELLS[0]))];
+    }
+    if ((*rng)() % 10 == 0) ret += " ||\n{| class=\"small\"\n| a || b\n|}";
+    ret += '\n';
+  }
+  return ret + "|}\n";
+}
+
+// _____________________________________________________________________________
+static std::string genArticle(std::mt19937* rng) {
+  // tables before and after the lead paragraph
+  std::string ret = genTable(rng);
+  ret += "The '''2018–19 season''' was the 115th season of [[SC Freiburg]] "
+         "and the club's 20th in the [[Bundesliga]].\n";
+  ret += genTable(rng);
+  ret += genTable(rng);
+  return ret + "\n== Season ==\n";
+}
+
+// _____________________________________________________________________________
+static size_t skipBytewise(const char* text, size_t pos) {
+  // the table skipping as done by the former IN_TABLE state of parse()
+  size_t depth = 1;
+  while (text[pos]) {
+    if (text[pos] == '|' && text[pos + 1] == '}') {
+      pos += 2;
+      if (--depth == 0) return pos;
+    } else if (text[pos] == '{' && text[pos + 1] == '|') {
+      depth++;
+      pos += 2;
+    } else {
+      pos++;
+    }
+  }
+  return pos;
+}
+
+// _____________________________________________________________________________
+static size_t skipScanned(const char* text, size_t pos) {
+  // the table skipping of parse()
+  size_t depth = 1;
+  while (true) {
+    pos += tableRun(text + pos);
+    if (!text[pos]) return pos;
+    if (text[pos] == '|' && text[pos + 1] == '}') {
+      pos += 2;
+      if (--depth == 0) return pos;
+    } else if (text[pos] == '{' && text[pos + 1] == '|') {
+      depth++;
+      pos += 2;
+    } else {
+      pos++;
+    }
+  }
+}
+
+// _____________________________________________________________________________
+template <typename F>
+static double bench(const std::vector<std::string>& articles, size_t bytes,
+                    F f) {
+  // returns the best throughput of f over all articles in MB/s
+  double best = 0;
+  for (size_t r = 0; r < RUNS; r++) {
+    auto t = std::chrono::steady_clock::now();
+    for (const auto& a : articles) f(a.c_str());
+    double s = std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - t).count();
+    best = std::max(best, bytes / s / (1024 * 1024));
+  }
+  return best;
+}
+
+// _____________________________________________________________________________
+int main() {
+  std::mt19937 rng(42);
+
+  std::vector<std::string> articles;
+  size_t bytes = 0;
+  for (size_t i = 0; i < ARTICLES; i++) {
+    articles.push_back(genArticle(&rng));
+    bytes += articles.back().size();
+  }
+
+  printf("table-heavy articles, %zu bytes on average, throughput in MB/s\n",
+         bytes / ARTICLES);
+  printf("%-28s %10s %10s %10s\n", "", "scalar", "sse2", "avx2");
+
+  // skip all tables of the articles
+  printf("%-28s %10.1f\n", "table skip, bytewise",
+         bench(articles, bytes, [](const char* a) {
+           for (size_t p = 0; a[p]; p++) {
+             if (a[p] == '{' && a[p + 1] == '|') p = skipBytewise(a, p + 2) - 1;
+             sink = p;
+           }
+         }));
+
+  const char* variants[] = {"scalar", "sse2", "avx2"};
+  printf("%-28s", "table skip, tableRun()");
+  for (const char* v : variants) {
+    if (!setScanVariant(v)) {
+      printf(" %10s", "-");
+      continue;
+    }
+    printf(" %10.1f", bench(articles, bytes, [](const char* a) {
+             for (size_t p = 0; a[p]; p++) {
+               if (a[p] == '{' && a[p + 1] == '|') {
+                 p = skipScanned(a, p + 2) - 1;
+               }
+               sink = p;
+             }
+           }));
+  }
+  printf("\n");
+
+  std::string out;
+  printf("%-28s", "abstract()");
+  for (const char* v : variants) {
+    if (!setScanVariant(v)) {
+      printf(" %10s", "-");
+      continue;
+    }
+    printf(" %10.1f", bench(articles, bytes, [&out](const char* a) {
+             abstract(a, &out);
+           }));
+  }
+  printf("\n");
+
+  return 0;
+}
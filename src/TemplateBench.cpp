@@ -0,0 +1,123 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "Templates.h"
+#include "WikiText.h"
+
+// number of lookups per measurement
+static const size_t LOOKUPS = 10000000;
+
+// number of generated articles
+static const size_t ARTICLES = 20000;
+
+// the articles are parsed this often, the best run is reported
+static const size_t RUNS = 5;
+
+// template calls as found in article leads, rendered and dropped ones
+static const char* CALLS[] = {
+    "{{As of|2010|5|1}}",
+    "{{convert|10|km|mi}}",
+    "{{convert|5|ft|6|in|m|abbr=on}}",
+    "{{lang|fr|la [[langue française]]}}",
+    "{{IPA|/ˈfraɪbʊərk/}}",
+    "{{nowrap|Baden-Württemberg}}",
+    "{{birth date and age|1970|1|2|df=y}}",
+    "{{circa|1900}}",
+    "{{ndash}}",
+    "{{cite web|url=http://freiburg.de|title=Freiburg|accessdate=2019}}",
+    "{{sfn|Smith|2010|p=12}}",
+    "{{efn|A note with a [[link]].}}",
+    "{{Use dmy dates|date=May 2019}}",
+    "{{Short description|City in Germany}}",
+    "{{Coord|47|59|N|7|51|E|display=title}}"};
+
+// _____________________________________________________________________________
+static void lookups(const char* label) {
+  // ns per lookup of registered and unregistered template names
+  static const char* NAMES[] = {"As of",      "convert", "Birth date and age",
+                                "cite web",   "sfn",     "Use dmy dates",
+                                "nowrap",     "efn",     "Short description",
+                                "lang"};
+  size_t n = sizeof(NAMES) / sizeof(NAMES[0]);
+  size_t lens[sizeof(NAMES) / sizeof(NAMES[0])];
+  for (size_t i = 0; i < n; i++) lens[i] = strlen(NAMES[i]);
+
+  size_t found = 0;
+  auto t = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < LOOKUPS; i++) {
+    found += templates()->get(NAMES[i % n], lens[i % n]) != nullptr;
+  }
+  double s = std::chrono::duration<double>(
+                 std::chrono::steady_clock::now() - t).count();
+
+  printf("%-36s %10zu %10.1f %8zu\n", label, templates()->size(),
+         s / LOOKUPS * 1e9, found * n / LOOKUPS);
+}
+
+// _____________________________________________________________________________
+static std::string genArticle(std::mt19937* rng) {
+  // a lead paragraph with a template every few words
+  static const char* WORDS[] = {"the", "of", "Freiburg", "is", "a", "city",
+                                "in", "[[Germany]],", "located", "on",
+                                "river", "[[Dreisam]]"};
+  std::string ret = "'''Freiburg''' ";
+  for (size_t i = 0; i < 60; i++) {
+    if ((*rng)() % 4 == 0) {
+      ret += CALLS[(*rng)() % (sizeof(CALLS) / sizeof(CALLS[0]))];
+    } else {
+      ret += WORDS[(*rng)() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+    }
+    ret += ' ';
+  }
+  return ret + "\n\n== History ==\n";
+}
+
+// _____________________________________________________________________________
+int main() {
+  std::mt19937 rng(42);
+
+  printf("%-36s %10s %10s %8s\n", "template lookups", "handlers", "ns / call",
+         "found");
+  lookups("built-in handlers");
+
+  // more handlers do not slow down the lookup
+  char name[32];
+  for (size_t i = 0; i < 1000; i++) {
+    snprintf(name, sizeof(name), "dummy template %zu", i);
+    templates()->add(name, [](const TemplateCall&, ArenaString*) {
+      return true;
+    });
+  }
+  lookups("with 1000 additional handlers");
+
+  std::vector<std::string> articles;
+  size_t bytes = 0;
+  for (size_t i = 0; i < ARTICLES; i++) {
+    articles.push_back(genArticle(&rng));
+    bytes += articles.back().size();
+  }
+
+  double best = 0;
+  std::string out;
+  for (size_t r = 0; r < RUNS; r++) {
+    auto t = std::chrono::steady_clock::now();
+    for (const auto& a : articles) abstract(a.c_str(), &out);
+    double s = std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - t).count();
+    best = std::max(best, ARTICLES / s);
+  }
+
+  printf("\nabstract() of template-heavy articles: %.0f articles/s,"
+         " %.1f MB/s\n",
+         best, best * bytes / ARTICLES / (1024 * 1024));
+
+  return 0;
+}
@@ -0,0 +1,565 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <cstdint>
+#include <cstring>
+#include "Templates.h"
+#include "WikiText.h"
+
+static const char* MONTHS[] = {"January",   "February", "March",    "April",
+                               "May",       "June",     "July",     "August",
+                               "September", "October",  "November", "December"};
+
+// units of {{convert}} which are not written as in the template
+static const std::pair<const char*, const char*> UNITS[] = {
+    {"km2", "km²"},    {"m2", "m²"},       {"sqmi", "sq mi"},
+    {"sqft", "sq ft"}, {"m3", "m³"},       {"cuft", "cu ft"},
+    {"C", "°C"},       {"F", "°F"},        {"kmh", "km/h"},
+    {"kph", "km/h"},   {"acre", "acres"}};
+
+// range separators of {{convert}}
+static const std::pair<const char*, const char*> RANGES[] = {
+    {"-", "–"},       {"–", "–"},         {"to", " to "},
+    {"to(-)", " to "}, {"and", " and "},  {"or", " or "},
+    {"x", " × "},      {"by", " × "},     {"+/-", " ± "}};
+
+// _____________________________________________________________________________
+static bool isWs(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// _____________________________________________________________________________
+static void trim(const char** val, size_t* len) {
+  while (*len && isWs(**val)) {
+    (*val)++;
+    (*len)--;
+  }
+  while (*len && isWs((*val)[*len - 1])) (*len)--;
+}
+
+// _____________________________________________________________________________
+static bool equals(const char* a, size_t len, const char* b) {
+  return strlen(b) == len && strncmp(a, b, len) == 0;
+}
+
+// _____________________________________________________________________________
+static int number(const char* val, size_t len) {
+  // the non-negative integer val, or -1
+  trim(&val, &len);
+  if (!len || len > 9) return -1;
+  int ret = 0;
+  for (size_t i = 0; i < len; i++) {
+    if (val[i] < '0' || val[i] > '9') return -1;
+    ret = ret * 10 + val[i] - '0';
+  }
+  return ret;
+}
+
+// characters of template names, lower-cased, 0 for characters which are a
+// space in names
+struct NameChars {
+  NameChars() {
+    for (size_t i = 0; i < 256; i++) c[i] = static_cast<char>(i);
+    for (char a = 'A'; a <= 'Z'; a++) c[static_cast<size_t>(a)] = a - 'A' + 'a';
+    for (char s : {' ', '\t', '\n', '\r', '_'}) c[static_cast<size_t>(s)] = 0;
+  }
+  char c[256];
+};
+
+static const NameChars NAME_CHARS;
+
+// _____________________________________________________________________________
+static size_t normalize(const char* name, size_t len, char* buf,
+                        size_t* hash) {
+  // write the normalized name to buf, which must hold MAX_TEMPLATE_NAME_S + 8
+  // bytes, and return its length, or MAX_TEMPLATE_NAME_S + 1 if it is too
+  // long. The hash of it is written to hash.
+  trim(&name, &len);
+  if (len > MAX_TEMPLATE_NAME_S) return MAX_TEMPLATE_NAME_S + 1;
+
+  size_t n = 0;
+  bool space = false;
+  for (size_t i = 0; i < len; i++) {
+    char c = NAME_CHARS.c[static_cast<unsigned char>(name[i])];
+    if (!c) {
+      space = true;
+      continue;
+    }
+    if (space) buf[n++] = ' ';
+    space = false;
+    buf[n++] = c;
+  }
+
+  // hash 8 bytes at a time
+  memset(buf + n, 0, 8);
+  uint64_t h = n;
+  for (size_t i = 0; i < n; i += 8) {
+    uint64_t w;
+    memcpy(&w, buf + i, 8);
+    h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 32;
+  }
+  *hash = h;
+  return n;
+}
+
+// _____________________________________________________________________________
+TemplateCall::TemplateCall(const char* str) : _str(str), _numPieces(1) {
+  _beg[0] = 0;
+  _eq[0] = 0;
+
+  // nested templates and links
+  size_t depth = 0;
+  size_t i = 0;
+  for (;; i++) {
+    i += strcspn(str + i, "{}[]|=");
+    char c = str[i];
+    if (!c) break;
+    if ((c == '{' || c == '[') && str[i + 1] == c) {
+      depth++;
+      i++;
+    } else if ((c == '}' || c == ']') && str[i + 1] == c) {
+      if (depth) depth--;
+      i++;
+    } else if (!depth && c == '|') {
+      _end[_numPieces - 1] = i;
+      if (_numPieces == MAX_TEMPLATE_ARGS + 1) return;
+      _beg[_numPieces] = i + 1;
+      _eq[_numPieces] = 0;
+      _numPieces++;
+    } else if (!depth && c == '=' && !_eq[_numPieces - 1]) {
+      _eq[_numPieces - 1] = i;
+    }
+  }
+  _end[_numPieces - 1] = i;
+}
+
+// _____________________________________________________________________________
+const char* TemplateCall::name() const { return _str; }
+
+// _____________________________________________________________________________
+size_t TemplateCall::nameLen() const { return _end[0]; }
+
+// _____________________________________________________________________________
+bool TemplateCall::arg(size_t i, const char** val, size_t* len) const {
+  // unnamed parameters are counted, but may also be given as i=val
+  size_t n = 0;
+  for (size_t p = 1; p < _numPieces; p++) {
+    if (!_eq[p]) {
+      if (++n != i) continue;
+      *val = _str + _beg[p];
+      *len = _end[p] - _beg[p];
+      return true;
+    }
+    if (static_cast<size_t>(number(_str + _beg[p], _eq[p] - _beg[p])) == i) {
+      *val = _str + _eq[p] + 1;
+      *len = _end[p] - _eq[p] - 1;
+      trim(val, len);
+      return true;
+    }
+  }
+  return false;
+}
+
+// _____________________________________________________________________________
+bool TemplateCall::named(const char* key, const char** val,
+                         size_t* len) const {
+  // the last one wins, as in MediaWiki
+  bool found = false;
+  for (size_t p = 1; p < _numPieces; p++) {
+    if (!_eq[p]) continue;
+    const char* k = _str + _beg[p];
+    size_t kLen = _eq[p] - _beg[p];
+    trim(&k, &kLen);
+    if (!equals(k, kLen, key)) continue;
+    *val = _str + _eq[p] + 1;
+    *len = _end[p] - _eq[p] - 1;
+    trim(val, len);
+    found = true;
+  }
+  return found;
+}
+
+// _____________________________________________________________________________
+bool TemplateCall::flag(const char* key) const {
+  const char* val;
+  size_t len;
+  if (!named(key, &val, &len)) return false;
+  return equals(val, len, "y") || equals(val, len, "yes") ||
+         equals(val, len, "Y") || equals(val, len, "Yes") ||
+         equals(val, len, "on") || equals(val, len, "true");
+}
+
+// _____________________________________________________________________________
+size_t TemplateCall::numArgs() const {
+  size_t ret = 0;
+  for (size_t p = 1; p < _numPieces; p++) ret += !_eq[p];
+  return ret;
+}
+
+// _____________________________________________________________________________
+TemplateRegistry::TemplateRegistry() : _slots(64), _size(0) {}
+
+// _____________________________________________________________________________
+void TemplateRegistry::add(const char* name, TemplateHandler handler) {
+  char buf[MAX_TEMPLATE_NAME_S + 8];
+  size_t hash;
+  size_t len = normalize(name, strlen(name), buf, &hash);
+  if (len > MAX_TEMPLATE_NAME_S || !handler) return;
+
+  Slot* slot = const_cast<Slot*>(find(buf, len, hash));
+  if (slot->handler) {
+    slot->handler = handler;
+    return;
+  }
+
+  if ((_size + 1) * 2 > _slots.size()) {
+    std::vector<Slot> old(_slots.size() * 2);
+    old.swap(_slots);
+    _size = 0;
+    for (const auto& s : old) {
+      if (s.handler) add(s.name.c_str(), s.handler);
+    }
+    slot = const_cast<Slot*>(find(buf, len, hash));
+  }
+
+  slot->name.assign(buf, len);
+  slot->handler = handler;
+  _size++;
+}
+
+// _____________________________________________________________________________
+TemplateHandler TemplateRegistry::get(const char* name, size_t len) const {
+  char buf[MAX_TEMPLATE_NAME_S + 8];
+  size_t hash;
+  len = normalize(name, len, buf, &hash);
+  if (len > MAX_TEMPLATE_NAME_S) return nullptr;
+  return find(buf, len, hash)->handler;
+}
+
+// _____________________________________________________________________________
+size_t TemplateRegistry::size() const { return _size; }
+
+// _____________________________________________________________________________
+const TemplateRegistry::Slot* TemplateRegistry::find(const char* name,
+                                                     size_t len,
+                                                     size_t hash) const {
+  // the slot of name, or the empty slot where it belongs
+  size_t mask = _slots.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    const Slot& s = _slots[i];
+    if (!s.handler) return &s;
+    if (s.name.size() == len && memcmp(s.name.data(), name, len) == 0)
+      return &s;
+  }
+}
+
+// _____________________________________________________________________________
+static void appendParsed(const char* val, size_t len, bool woBr,
+                         ArenaString* out) {
+  // parse a parameter value as wikitext
+  ArenaString arg(val, len);
+  ArenaString txt;
+  parse(arg.c_str(), 1, woBr, &txt);
+  out->append(txt);
+}
+
+// _____________________________________________________________________________
+static void appendArg(const TemplateCall& call, size_t i, bool woBr,
+                      ArenaString* out) {
+  // parse the i-th unnamed parameter as wikitext
+  const char* val;
+  size_t len;
+  if (!call.arg(i, &val, &len)) return;
+  appendParsed(val, len, woBr, out);
+}
+
+// _____________________________________________________________________________
+static void appendTrimmed(const TemplateCall& call, size_t i,
+                          ArenaString* out) {
+  // the same, but trimmed
+  const char* val;
+  size_t len;
+  if (!call.arg(i, &val, &len)) return;
+  trim(&val, &len);
+  appendParsed(val, len, true, out);
+}
+
+// _____________________________________________________________________________
+static void appendDate(const TemplateCall& call, size_t first, bool mdy,
+                       ArenaString* out) {
+  // the date given by the year, month and day parameters starting at first,
+  // like 1 May 1990, or May 1, 1990 if mdy
+  const char* year;
+  size_t yearLen;
+  if (!call.arg(first, &year, &yearLen)) return;
+  trim(&year, &yearLen);
+
+  const char* month = nullptr;
+  size_t monthLen = 0;
+  if (call.arg(first + 1, &month, &monthLen)) {
+    trim(&month, &monthLen);
+    int m = number(month, monthLen);
+    if (m >= 1 && m <= 12) {
+      month = MONTHS[m - 1];
+      monthLen = strlen(month);
+    }
+  }
+
+  const char* day = nullptr;
+  size_t dayLen = 0;
+  if (monthLen && call.arg(first + 2, &day, &dayLen)) {
+    trim(&day, &dayLen);
+    int d = number(day, dayLen);
+    if (d < 1 || d > 31) dayLen = 0;
+    // without leading zeros
+    while (dayLen > 1 && day[0] == '0') {
+      day++;
+      dayLen--;
+    }
+  }
+
+  if (mdy) {
+    if (monthLen) {
+      out->append(month, monthLen);
+      if (dayLen) {
+        *out += ' ';
+        out->append(day, dayLen);
+        *out += ',';
+      }
+      *out += ' ';
+    }
+  } else {
+    if (dayLen) {
+      out->append(day, dayLen);
+      *out += ' ';
+    }
+    if (monthLen) {
+      out->append(month, monthLen);
+      *out += ' ';
+    }
+  }
+  out->append(year, yearLen);
+}
+
+// _____________________________________________________________________________
+static bool dropPage(const TemplateCall&, ArenaString*) { return false; }
+
+// _____________________________________________________________________________
+static bool firstArg(const TemplateCall& call, ArenaString* out) {
+  appendArg(call, 1, true, out);
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool secondArg(const TemplateCall& call, ArenaString* out) {
+  appendArg(call, 2, true, out);
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool lastArg(const TemplateCall& call, ArenaString* out) {
+  appendArg(call, call.numArgs(), true, out);
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool math(const TemplateCall& call, ArenaString* out) {
+  // brackets are kept in formulas
+  appendArg(call, 1, false, out);
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool asOf(const TemplateCall& call, ArenaString* out) {
+  // {{As of|2010|5|1}} -> As of 1 May 2010
+  const char* val;
+  size_t len;
+  if (call.named("alt", &val, &len)) {
+    appendParsed(val, len, true, out);
+    return true;
+  }
+
+  if (call.flag("since")) {
+    *out += "Since ";
+  } else if (call.flag("lc")) {
+    *out += "as of ";
+  } else {
+    *out += "As of ";
+  }
+
+  bool mdy = call.named("df", &val, &len) &&
+             (equals(val, len, "US") || equals(val, len, "us"));
+  appendDate(call, 1, mdy, out);
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool date(const TemplateCall& call, ArenaString* out) {
+  // {{birth date|1990|5|1}} -> May 1, 1990, day first with df=y
+  appendDate(call, 1, !call.flag("df"), out);
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool convert(const TemplateCall& call, ArenaString* out) {
+  // {{convert|10|to|20|km|mi}} -> 10 to 20 km, {{convert|5|ft|6|in|m}} ->
+  // 5 ft 6 in. The converted value is left out.
+  size_t i = 1;
+  appendTrimmed(call, i++, out);
+
+  const char* val;
+  size_t len;
+  if (call.arg(i, &val, &len)) {
+    trim(&val, &len);
+    for (const auto& r : RANGES) {
+      if (!equals(val, len, r.first)) continue;
+      *out += r.second;
+      appendTrimmed(call, i + 1, out);
+      i += 2;
+      break;
+    }
+  }
+
+  while (call.arg(i, &val, &len)) {
+    trim(&val, &len);
+    *out += ' ';
+    const char* unit = nullptr;
+    for (const auto& u : UNITS) {
+      if (equals(val, len, u.first)) unit = u.second;
+    }
+    if (unit) {
+      *out += unit;
+    } else {
+      appendParsed(val, len, true, out);
+    }
+
+    // another value with its unit follows, as in 5 ft 6 in
+    const char* next;
+    size_t nextLen;
+    if (!call.arg(i + 1, &next, &nextLen) || number(next, nextLen) < 0 ||
+        !call.arg(i + 2, &next, &nextLen)) {
+      break;
+    }
+    *out += ' ';
+    appendTrimmed(call, i + 1, out);
+    i += 2;
+  }
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool frac(const TemplateCall& call, ArenaString* out) {
+  // {{frac|2}} -> 1/2, {{frac|1|2}} -> 1/2, {{frac|3|1|2}} -> 3 1/2
+  size_t n = call.numArgs();
+  if (n == 1) {
+    *out += "1/";
+    appendTrimmed(call, 1, out);
+  } else if (n == 2) {
+    appendTrimmed(call, 1, out);
+    *out += '/';
+    appendTrimmed(call, 2, out);
+  } else if (n >= 3) {
+    appendTrimmed(call, 1, out);
+    *out += ' ';
+    appendTrimmed(call, 2, out);
+    *out += '/';
+    appendTrimmed(call, 3, out);
+  }
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool circa(const TemplateCall& call, ArenaString* out) {
+  *out += "c.";
+  if (call.numArgs()) {
+    *out += ' ';
+    appendTrimmed(call, 1, out);
+  }
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool ndash(const TemplateCall&, ArenaString* out) {
+  *out += "–";
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool spacedNdash(const TemplateCall&, ArenaString* out) {
+  *out += " – ";
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool mdash(const TemplateCall&, ArenaString* out) {
+  *out += "—";
+  return true;
+}
+
+// _____________________________________________________________________________
+static bool nbsp(const TemplateCall&, ArenaString* out) {
+  // as the decoded &nbsp;
+  *out += "\xC2\xA0";
+  return true;
+}
+
+// built-in handlers, by template name
+static const std::pair<const char*, TemplateHandler> BUILTIN[] = {
+    {"disambiguation", dropPage},
+    {"disambig", dropPage},
+    {"disamb", dropPage},
+    {"dab", dropPage},
+    {"human name disambiguation", dropPage},
+    {"hndis", dropPage},
+    {"geodis", dropPage},
+    {"math", math},
+    {"as of", asOf},
+    {"convert", convert},
+    {"cvt", convert},
+    {"lang", secondArg},
+    {"native name", secondArg},
+    {"transl", lastArg},
+    {"ipa", firstArg},
+    {"nowrap", firstArg},
+    {"nobr", firstArg},
+    {"small", firstArg},
+    {"smaller", firstArg},
+    {"big", firstArg},
+    {"nobold", firstArg},
+    {"noitalic", firstArg},
+    {"abbr", firstArg},
+    {"ill", firstArg},
+    {"flag", firstArg},
+    {"flagcountry", firstArg},
+    {"resize", lastArg},
+    {"birth date", date},
+    {"birth date and age", date},
+    {"bda", date},
+    {"death date", date},
+    {"death date and age", date},
+    {"start date", date},
+    {"end date", date},
+    {"circa", circa},
+    {"c.", circa},
+    {"frac", frac},
+    {"sfrac", frac},
+    {"ndash", ndash},
+    {"snd", spacedNdash},
+    {"spaced ndash", spacedNdash},
+    {"mdash", mdash},
+    {"nbsp", nbsp}};
+
+// _____________________________________________________________________________
+static TemplateRegistry builtinTemplates() {
+  TemplateRegistry ret;
+  for (const auto& t : BUILTIN) ret.add(t.first, t.second);
+  return ret;
+}
+
+// _____________________________________________________________________________
+TemplateRegistry* templates() {
+  static TemplateRegistry reg = builtinTemplates();
+  return &reg;
+}
@@ -0,0 +1,86 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#ifndef TEMPLATES_H_
+#define TEMPLATES_H_
+
+#include <string>
+#include <vector>
+#include "Arena.h"
+
+// template names longer than this are never looked up
+static const size_t MAX_TEMPLATE_NAME_S = 64;
+
+// parameters after this are ignored
+static const size_t MAX_TEMPLATE_ARGS = 32;
+
+// a template call, the content between {{ and }} split into the name and
+// the parameters at | outside of nested templates and links
+class TemplateCall {
+ public:
+  explicit TemplateCall(const char* str);
+
+  // the name as written, untrimmed
+  const char* name() const;
+  size_t nameLen() const;
+
+  // the i-th unnamed parameter, starting at 1
+  bool arg(size_t i, const char** val, size_t* len) const;
+
+  // the parameter key=val, trimmed
+  bool named(const char* key, const char** val, size_t* len) const;
+
+  // the named parameter is y, yes or on
+  bool flag(const char* key) const;
+
+  // the number of unnamed parameters
+  size_t numArgs() const;
+
+ private:
+  const char* _str;
+  size_t _numPieces;
+  // begin and end of the pieces, the first one is the name
+  size_t _beg[MAX_TEMPLATE_ARGS + 1];
+  size_t _end[MAX_TEMPLATE_ARGS + 1];
+  // position of the first top-level = of the piece, or 0
+  size_t _eq[MAX_TEMPLATE_ARGS + 1];
+};
+
+// appends the clear text of a template call to out, returns false if the
+// whole page should be dropped
+typedef bool (*TemplateHandler)(const TemplateCall& call, ArenaString* out);
+
+// the templates which are rendered, by name. Names are compared as
+// MediaWiki does, but case-insensitive: leading and trailing whitespace is
+// ignored, and underscores and whitespace runs are a single space.
+class TemplateRegistry {
+ public:
+  TemplateRegistry();
+
+  // name must not be longer than MAX_TEMPLATE_NAME_S
+  void add(const char* name, TemplateHandler handler);
+
+  // nullptr if there is no handler for the template
+  TemplateHandler get(const char* name, size_t len) const;
+
+  size_t size() const;
+
+ private:
+  struct Slot {
+    std::string name;
+    TemplateHandler handler = nullptr;
+  };
+
+  // open addressing, at most half full
+  std::vector<Slot> _slots;
+  size_t _size;
+
+  const Slot* find(const char* name, size_t len, size_t hash) const;
+};
+
+// the registry used by the parser, with the built-in handlers. Handlers
+// may be added before parsing starts.
+TemplateRegistry* templates();
+
+#endif  // TEMPLATES_H_
@@ -0,0 +1,245 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <cstdint>
+#include <cstring>
+#include "TextScan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TEXTSCAN_X86
+#endif
+
+// The vectorized scanners load the whole aligned blocks holding the string,
+// which includes bytes before its start and after its terminating 0. These
+// bytes are outside of the string object, but on the same page as a byte of
+// it, so they are mapped. Their values never change the result. The loads
+// are not instrumented by AddressSanitizer, which would report them.
+#define WHOLE_BLOCKS __attribute__((no_sanitize_address))
+
+// _____________________________________________________________________________
+static bool isMarkup(char c) {
+  switch (c) {
+    case 0:
+    case '\n':
+    case '_':
+    case '\'':
+    case '<':
+    case '{':
+    case '[':
+    case '(':
+      return true;
+    default:
+      return false;
+  }
+}
+
+// _____________________________________________________________________________
+static size_t plainRunScalar(const char* str, bool prevSpace) {
+  for (size_t i = 0;; i++) {
+    if (isMarkup(str[i])) return i;
+    if (str[i] == ' ' && (i ? str[i - 1] == ' ' : prevSpace)) return i;
+  }
+}
+
+// _____________________________________________________________________________
+static size_t tableRunScalar(const char* str) {
+  for (size_t i = 0;; i++) {
+    if (!str[i]) return i;
+    if (str[i] == '|' && str[i + 1] == '}') return i;
+    if (str[i] == '{' && str[i + 1] == '|') return i;
+  }
+}
+
+#ifdef TEXTSCAN_X86
+// _____________________________________________________________________________
+WHOLE_BLOCKS static size_t plainRunSse2(const char* str, bool prevSpace) {
+  const __m128i nl = _mm_set1_epi8('\n');
+  const __m128i us = _mm_set1_epi8('_');
+  const __m128i ap = _mm_set1_epi8('\'');
+  const __m128i lt = _mm_set1_epi8('<');
+  const __m128i cu = _mm_set1_epi8('{');
+  const __m128i sq = _mm_set1_epi8('[');
+  const __m128i br = _mm_set1_epi8('(');
+  const __m128i sp = _mm_set1_epi8(' ');
+  const __m128i zero = _mm_setzero_si128();
+
+  const char* p = reinterpret_cast<const char*>(
+      reinterpret_cast<uintptr_t>(str) & ~static_cast<uintptr_t>(15));
+  uint32_t valid = ~0u << (str - p);
+  // the space mask shifted into the next block, the bytes before str are
+  // masked out, prevSpace stands for the one before it
+  uint32_t carry = static_cast<uint32_t>(prevSpace) << (str - p);
+
+  while (true) {
+    __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i m = _mm_or_si128(
+        _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, us)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, ap), _mm_cmpeq_epi8(v, lt))),
+        _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, cu), _mm_cmpeq_epi8(v, sq)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, br), _mm_cmpeq_epi8(v, zero))));
+    uint32_t spaces = _mm_movemask_epi8(_mm_cmpeq_epi8(v, sp)) & valid;
+    uint32_t hits = _mm_movemask_epi8(m) | (spaces & ((spaces << 1) | carry));
+    hits &= valid;
+    if (hits) return p + __builtin_ctz(hits) - str;
+    carry = spaces >> 15;
+    valid = ~0u;
+    p += 16;
+  }
+}
+
+// _____________________________________________________________________________
+WHOLE_BLOCKS __attribute__((target("avx2"))) static size_t plainRunAvx2(
+    const char* str, bool prevSpace) {
+  const __m256i nl = _mm256_set1_epi8('\n');
+  const __m256i us = _mm256_set1_epi8('_');
+  const __m256i ap = _mm256_set1_epi8('\'');
+  const __m256i lt = _mm256_set1_epi8('<');
+  const __m256i cu = _mm256_set1_epi8('{');
+  const __m256i sq = _mm256_set1_epi8('[');
+  const __m256i br = _mm256_set1_epi8('(');
+  const __m256i sp = _mm256_set1_epi8(' ');
+  const __m256i zero = _mm256_setzero_si256();
+
+  const char* p = reinterpret_cast<const char*>(
+      reinterpret_cast<uintptr_t>(str) & ~static_cast<uintptr_t>(31));
+  uint64_t valid = ~0ull << (str - p);
+  uint64_t carry = static_cast<uint64_t>(prevSpace) << (str - p);
+
+  while (true) {
+    __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i m = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpeq_epi8(v, us)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, ap),
+                            _mm256_cmpeq_epi8(v, lt))),
+        _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, cu), _mm256_cmpeq_epi8(v, sq)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, br),
+                            _mm256_cmpeq_epi8(v, zero))));
+    uint64_t spaces =
+        static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, sp))) &
+        valid;
+    uint64_t hits = static_cast<uint32_t>(_mm256_movemask_epi8(m)) |
+                    (spaces & ((spaces << 1) | carry));
+    hits &= valid;
+    if (hits) return p + __builtin_ctzll(hits) - str;
+    carry = spaces >> 31;
+    valid = ~0ull;
+    p += 32;
+  }
+}
+
+// _____________________________________________________________________________
+WHOLE_BLOCKS static size_t tableRunSse2(const char* str) {
+  const __m128i pipe = _mm_set1_epi8('|');
+  const __m128i open = _mm_set1_epi8('{');
+  const __m128i close = _mm_set1_epi8('}');
+  const __m128i zero = _mm_setzero_si128();
+
+  const char* p = reinterpret_cast<const char*>(
+      reinterpret_cast<uintptr_t>(str) & ~static_cast<uintptr_t>(15));
+  uint32_t valid = ~0u << (str - p);
+
+  while (true) {
+    __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+    uint32_t pipes = _mm_movemask_epi8(_mm_cmpeq_epi8(v, pipe));
+    uint32_t opens = _mm_movemask_epi8(_mm_cmpeq_epi8(v, open));
+    uint32_t closes = _mm_movemask_epi8(_mm_cmpeq_epi8(v, close));
+    // the pairs within the block, and a possible pair across the block end,
+    // which is checked by the caller
+    uint32_t hits = (pipes & (closes >> 1)) | (opens & (pipes >> 1)) |
+                    ((pipes | opens) & 0x8000) |
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+    hits &= valid;
+    if (hits) return p + __builtin_ctz(hits) - str;
+    valid = ~0u;
+    p += 16;
+  }
+}
+
+// _____________________________________________________________________________
+WHOLE_BLOCKS __attribute__((target("avx2"))) static size_t tableRunAvx2(
+    const char* str) {
+  const __m256i pipe = _mm256_set1_epi8('|');
+  const __m256i open = _mm256_set1_epi8('{');
+  const __m256i close = _mm256_set1_epi8('}');
+  const __m256i zero = _mm256_setzero_si256();
+
+  const char* p = reinterpret_cast<const char*>(
+      reinterpret_cast<uintptr_t>(str) & ~static_cast<uintptr_t>(31));
+  uint64_t valid = ~0ull << (str - p);
+
+  while (true) {
+    __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(p));
+    uint64_t pipes =
+        static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, pipe)));
+    uint64_t opens =
+        static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, open)));
+    uint64_t closes = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, close)));
+    uint64_t hits =
+        (pipes & (closes >> 1)) | (opens & (pipes >> 1)) |
+        ((pipes | opens) & 0x80000000ull) |
+        static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)));
+    hits &= valid;
+    if (hits) return p + __builtin_ctzll(hits) - str;
+    valid = ~0ull;
+    p += 32;
+  }
+}
+#endif
+
+struct Scanner {
+  const char* name;
+  size_t (*plainRun)(const char*, bool);
+  size_t (*tableRun)(const char*);
+};
+
+// _____________________________________________________________________________
+static Scanner selectScanner() {
+#ifdef TEXTSCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return {"avx2", plainRunAvx2, tableRunAvx2};
+  }
+  return {"sse2", plainRunSse2, tableRunSse2};
+#else
+  return {"scalar", plainRunScalar, tableRunScalar};
+#endif
+}
+
+static Scanner scanner = selectScanner();
+
+// _____________________________________________________________________________
+size_t plainRun(const char* str, bool prevSpace) {
+  return scanner.plainRun(str, prevSpace);
+}
+
+// _____________________________________________________________________________
+size_t tableRun(const char* str) { return scanner.tableRun(str); }
+
+// _____________________________________________________________________________
+const char* scanVariant() { return scanner.name; }
+
+// _____________________________________________________________________________
+bool setScanVariant(const char* name) {
+  if (!strcmp(name, "scalar")) {
+    scanner = {"scalar", plainRunScalar, tableRunScalar};
+    return true;
+  }
+#ifdef TEXTSCAN_X86
+  if (!strcmp(name, "sse2")) {
+    scanner = {"sse2", plainRunSse2, tableRunSse2};
+    return true;
+  }
+  if (!strcmp(name, "avx2") && __builtin_cpu_supports("avx2")) {
+    scanner = {"avx2", plainRunAvx2, tableRunAvx2};
+    return true;
+  }
+#endif
+  return false;
+}
@@ -0,0 +1,32 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#ifndef TEXTSCAN_H_
+#define TEXTSCAN_H_
+
+#include <cstddef>
+
+// Vectorized scanning of wikitext. The scanners process aligned 16 (SSE2) or
+// 32 (AVX2) byte blocks, the variant is chosen at runtime based on the CPU,
+// with a scalar fallback. Aligned blocks never cross a page, so reading the
+// bytes of a block outside of the string is safe (see TextScan.cpp).
+
+// length of the prefix of the 0-terminated str which the TEXT state of
+// parse() copies unchanged: no markup character (\n _ ' < { [ () and no
+// space following a space. prevSpace tells if the character before str is
+// a space, str[-1] is never read.
+size_t plainRun(const char* str, bool prevSpace);
+
+// length of a prefix of the 0-terminated str which contains no 0 and where
+// no {| or |} starts. It may end before other characters, the caller checks
+// the character at the end.
+size_t tableRun(const char* str);
+
+// name of the scanner variant in use ("avx2", "sse2" or "scalar")
+const char* scanVariant();
+
+// use the scanner variant name, returns false if the CPU does not support it
+bool setScanVariant(const char* name);
+
+#endif  // TEXTSCAN_H_
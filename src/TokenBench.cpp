@@ -0,0 +1,175 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include "WikiDumpReader.h"
+#include "pfxml.h"
+
+// number of pages of the generated dump
+static const size_t PAGES = 20000;
+
+// every measurement is repeated this often, the best run is reported
+static const size_t RUNS = 5;
+
+// keeps the classification loops from being optimized away
+static volatile size_t sink = 0;
+
+// _____________________________________________________________________________
+static std::string genDump(std::mt19937* rng) {
+  // a dump with the tags and attributes of a real one and short texts, so
+  // the tokenizer and not the text copying dominates
+  static const char* WORDS[] = {"the", "of", "Freiburg", "is", "a", "city",
+                                "in", "Baden-Württemberg,", "Germany.",
+                                "[[Dreisam]]", "{{lang|de|Bächle}}"};
+  std::stringstream ss;
+  ss << "<mediawiki xmlns=\"http://www.mediawiki.org/xml/export-0.10/\" "
+        "xml:lang=\"en\">\n";
+  for (size_t i = 0; i < PAGES; i++) {
+    ss << "  <page>\n    <title>Page " << i << "</title>\n    <ns>0</ns>\n"
+       << "    <id>" << i + 1 << "</id>\n    <revision>\n      <id>"
+       << 1000 + i << "</id>\n      <parentid>" << 999 + i
+       << "</parentid>\n      <timestamp>2019-01-01T00:00:00Z</timestamp>\n"
+       << "      <contributor>\n        <username>Someone</username>\n"
+       << "        <id>42</id>\n      </contributor>\n"
+       << "      <comment>fix</comment>\n      <model>wikitext</model>\n"
+       << "      <format>text/x-wiki</format>\n"
+       << "      <text bytes=\"1000\" xml:space=\"preserve\">";
+    size_t words = 20 + (*rng)() % 200;
+    for (size_t w = 0; w < words; w++) {
+      ss << WORDS[(*rng)() % (sizeof(WORDS) / sizeof(WORDS[0]))] << ' ';
+    }
+    ss << "</text>\n      <sha1>0123456789abcdefghijklmnopqrstu</sha1>\n"
+       << "    </revision>\n  </page>\n";
+  }
+  ss << "</mediawiki>\n";
+  return ss.str();
+}
+
+// _____________________________________________________________________________
+template <typename F>
+static double bench(size_t bytes, F f) {
+  // returns the best throughput of f in MB/s
+  double best = 0;
+  for (size_t r = 0; r < RUNS; r++) {
+    auto t = std::chrono::steady_clock::now();
+    f();
+    double s = std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - t).count();
+    best = std::max(best, bytes / s / (1024 * 1024));
+  }
+  return best;
+}
+
+// _____________________________________________________________________________
+int main(int argc, char** argv) {
+  // the dump given as the argument, for example a slice of a real dump, or
+  // a generated one
+  std::string path;
+  std::string tmpPath;
+  if (argc > 1) {
+    path = argv[1];
+  } else {
+    std::mt19937 rng(42);
+    char tpl[] = "/tmp/tokenbench-XXXXXX";
+    int fd = mkstemp(tpl);
+    if (fd < 0) {
+      perror("mkstemp");
+      return 1;
+    }
+    close(fd);
+    tmpPath = path = tpl;
+    std::ofstream(path) << genDump(&rng);
+  }
+
+  std::ifstream in(path);
+  std::string dump((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+
+  // the character classification alone, over all bytes of the dump
+  double stdClass = bench(dump.size(), [&dump]() {
+    size_t n = 0;
+    for (char c : dump) {
+      n += std::isspace(static_cast<unsigned char>(c)) != 0;
+      n += std::isalnum(static_cast<unsigned char>(c)) || c == '-' ||
+           c == '_' || c == '.';
+    }
+    sink = n;
+  });
+  double tableClass = bench(dump.size(), [&dump]() {
+    size_t n = 0;
+    for (char c : dump) {
+      n += pfxml::is_space(c);
+      n += pfxml::is_name_char(c);
+    }
+    sink = n;
+  });
+
+  // the tokenizer, from a memory mapping to leave out the reading
+  pfxml::file_opts opts;
+  opts.mmap = true;
+  opts.readahead = false;
+  size_t tags = 0;
+  double next = bench(dump.size(), [&path, &opts, &tags]() {
+    pfxml::file xml(path, opts);
+    tags = 0;
+    while (xml.next()) tags++;
+  });
+
+  // the titles and texts of all pages, tag by tag as main() formerly did
+  size_t pages = 0;
+  double generic = bench(dump.size(), [&path, &opts, &pages]() {
+    pfxml::file xml(path, opts);
+    size_t stage = 0;
+    pages = 0;
+    while (xml.next()) {
+      const auto& cur = xml.get();
+      if (xml.level() == 2 && strcmp(cur.name, "page") == 0) {
+        stage = 1;
+      } else if (stage == 1 && xml.level() == 3 &&
+                 strcmp(cur.name, "title") == 0) {
+        xml.next();
+        sink = strlen(xml.get().text);
+      } else if (stage == 1 && xml.level() == 3 &&
+                 strcmp(cur.name, "revision") == 0) {
+        stage = 2;
+      } else if (stage == 2 && xml.level() == 4 &&
+                 strcmp(cur.name, "text") == 0) {
+        xml.next();
+        sink = strlen(xml.get().text);
+        pages++;
+      }
+    }
+  });
+
+  // the same with the reader, which skips the revision metadata
+  Namespaces ns;
+  double reader = bench(dump.size(), [&path, &opts, &ns]() {
+    pfxml::file xml(path, opts);
+    WikiDumpReader dump(&xml, ns);
+    Page page;
+    while (dump.next(&page)) sink = strlen(page.title) + strlen(page.text);
+  });
+
+  printf("%s, %zu bytes, %zu tags, %zu pages\n",
+         argc > 1 ? path.c_str() : "generated dump", dump.size(), tags, pages);
+  printf("%-44s %10s\n", "", "MB/s");
+  printf("%-44s %10.1f\n", "std::isspace() + std::isalnum()", stdClass);
+  printf("%-44s %10.1f\n", "pfxml::is_space() + pfxml::is_name_char()",
+         tableClass);
+  printf("%-44s %10.1f\n", "pfxml::file::next()", next);
+  printf("%-44s %10.1f\n", "pages via pfxml::file::next()", generic);
+  printf("%-44s %10.1f\n", "pages via WikiDumpReader::next()", reader);
+
+  if (!tmpPath.empty()) unlink(tmpPath.c_str());
+  return 0;
+}
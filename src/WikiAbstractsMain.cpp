@@ -2,557 +2,656 @@
 // Chair of Algorithms and Data Structures.
 // Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
 
+#include <strings.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <climits>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <set>
+#include <thread>
+#include "Namespaces.h"
+#include "Output.h"
+#include "Queue.h"
+#include "RunStats.h"
+#include "WikiDumpReader.h"
+#include "WikiText.h"
 #include "pfxml.h"
 
-enum class RetCode { SUCCESS = 0, MISSING_WIKI_DUMP = 1, PARSE_ERROR = 2 };
-
-enum TextStage {
-  LBEG,
-  TEXT,
-  IN_CURL,
-  IN_TABLE,
-  IN_SQ,
-  IN_SSQ,
-  IN_BR,
-  IN_H,
-  IN_H_TIT,
-  IN_H_CL,
-  IN_TAG
+enum class RetCode {
+  SUCCESS = 0,
+  MISSING_WIKI_DUMP = 1,
+  PARSE_ERROR = 2,
+  INVALID_ARGUMENT = 3,
+  OUTPUT_ERROR = 4
 };
 
-// namespaces which should be dropped
-static const std::set<std::string> DROP_NS = {
-    "User",
-    "Wikipedia",
-    "File",
-    "MediaWiki",
-    "Template",
-    "Help",
-    "Category",
-    "Portal",
-    "Book",
-    "Draft",
-    "TimedText",
-    "Module",
-    "Education Program",
-    "Gadget",
-    "Gadget definition",
-    "Special",
-    "Media"
+// maximum number of pages handed to a worker thread at once
+static const size_t BATCH_PAGES = 512;
+
+// maximum accumulated text size of a batch
+static const size_t BATCH_BYTES = 4 * 1024 * 1024;
+
+// upper bounds of the numeric options
+static const long MAX_THREADS = 4096;
+static const long MAX_SLOWEST = 1000000;
+static const double MAX_BUFFER_MB = 64 * 1024;
+
+struct Config {
+  Config()
+      : threads(1),
+        ordered(true),
+        shard(0),
+        numShards(1),
+        shards(1),
+        bufferSize(OUTPUT_BUFFER_S),
+        flushEvery(0),
+        ioStats(false),
+        memStats(false),
+        stats(false),
+        slowest(SLOWEST_PAGES) {}
+  size_t threads;
+  bool ordered;
+
+  // process only the shard-th of numShards byte ranges of the dump
+  size_t shard;
+  size_t numShards;
+
+  // number of shards processed in parallel
+  size_t shards;
+
+  size_t bufferSize;
+  size_t flushEvery;
+
+  // report input and parser memory statistics to stderr
+  bool ioStats;
+  bool memStats;
+
+  // report the progress to stderr, and the slowest pages at the end
+  bool stats;
+  size_t slowest;
+
+  // the namespaces of the pages to output
+  Namespaces ns;
+
+  pfxml::file_opts xmlOpts;
 };
 
-std::string parse(const char* text, size_t maxParas, bool woBr);
+struct BatchPage {
+  std::string title;
+  std::string text;
+  bool redirect;
+};
+
+struct Batch {
+  size_t id;
+  // number of used pages, page objects are recycled to keep their capacity
+  size_t size;
+  std::vector<BatchPage> pages;
+  std::string out;
+  // number of pages written to out
+  size_t emitted;
+};
 
 // _____________________________________________________________________________
-bool usePage(const std::string& tit) {
-  // returns true if a page should be used, based on title
+bool isRedirect(const char* text) {
+  // older dumps have no <redirect>, the text starts with #REDIRECT
+  while (pfxml::is_space(*text)) text++;
+  return strncasecmp(text, "#redirect", 9) == 0;
+}
 
-  auto nsPos = tit.find(':');
-  if (nsPos != std::string::npos) {
-    auto ns = tit.substr(0, nsPos);
-    if (DROP_NS.count(ns)) return false;
+// _____________________________________________________________________________
+bool processPage(const char* title, const char* text, bool redirect,
+                 std::string* out, RunStats* stats) {
+  // append the output line for a single page to out, returns false if the
+  // page was dropped. If stats is given, the page is counted there.
+
+  static thread_local std::string abstr;
+  AbstractTimes times;
+  bool kept = abstract(text, &abstr, stats ? &times : 0);
+
+  if (abstr.size()) {
+    std::chrono::steady_clock::time_point t;
+    if (stats) t = std::chrono::steady_clock::now();
+    pfxml::file::decode(title, out);
+    *out += '\t';
+    *out += abstr;
+    *out += '\n';
+    if (stats) times.decodeNs += nsSince(&t);
   }
-  return true;
+
+  if (stats) {
+    if (abstr.size()) {
+      stats->emitted++;
+    } else if (!kept) {
+      stats->skippedDisambiguation++;
+    } else if (redirect || isRedirect(text)) {
+      stats->skippedRedirect++;
+    } else {
+      stats->skippedEmpty++;
+    }
+    stats->parseNs += times.parseNs;
+    stats->decodeNs += times.decodeNs;
+
+    uint64_t ns = times.parseNs + times.decodeNs;
+    stats->pageNs.add(ns);
+    stats->slowest.add(ns, title, text);
+  }
+
+  return abstr.size();
 }
 
 // _____________________________________________________________________________
-std::string parseSSq(const char* str) {
-  // parse a single squared command like [http://google.de], usually used
-  // for external links
+bool readPage(WikiDumpReader* dump, Page* page, RunStats* stats) {
+  // the next page of the dump, if stats is given, the time and the input
+  // read are counted there
 
-  std::string ret = str;
+  if (!stats) return dump->next(page);
 
-  std::vector<std::string> split;
+  DumpStats before = dump->stats();
+  auto t = std::chrono::steady_clock::now();
+  bool ret = dump->next(page);
+  stats->xmlNs += nsSince(&t);
 
-  size_t last = 0;
-  while (last != std::string::npos) {
-    auto pos = ret.find(' ', last + 1);
-    split.push_back(ret.substr(last, pos - last));
-    if (pos != std::string::npos) pos++;
-    last = pos;
-  }
+  DumpStats after = dump->stats();
+  stats->bytes += after.bytes - before.bytes;
+  stats->pages += after.pages - before.pages;
+  stats->skippedNs += after.droppedNs - before.droppedNs;
+  return ret;
+}
 
-  if (split.size() == 0) return "";
+// _____________________________________________________________________________
+void writeOut(Output* os, const std::string& out, size_t pages,
+              RunStats* stats) {
+  // write the output of pages, if stats is given, the time is counted there
+  if (!stats) {
+    os->write(out);
+    os->pagesDone(pages);
+    return;
+  }
+  auto t = std::chrono::steady_clock::now();
+  os->write(out);
+  os->pagesDone(pages);
+  stats->outputNs += nsSince(&t);
+}
 
-  return parse(split.back().c_str(), 1, true);
+// _____________________________________________________________________________
+void processSingle(WikiDumpReader* dump, Output* os, RunStats* stats) {
+  std::string out;
+  Page page;
+  while (readPage(dump, &page, stats)) {
+    out.clear();
+    if (processPage(page.title, page.text, page.redirect[0], &out, stats)) {
+      writeOut(os, out, 1, stats);
+    }
+  }
 }
 
 // _____________________________________________________________________________
-std::string parseSq(const char* str) {
-  // parse a double squared command like [[Freiburg im Breisgau]], usually used
-  // for internal links
+void processParallel(WikiDumpReader* dump, size_t numThreads, bool ordered,
+                     Output* os, RunStats* stats) {
+  // the calling thread reads the dump and hands batches of pages to
+  // numThreads workers, a dedicated writer thread outputs the results
+
+  Queue<Batch*> idle, work, done;
+
+  // the number of batches bounds the amount of pages in flight
+  std::vector<Batch> batches(2 * numThreads + 2);
+  for (auto& b : batches) idle.push(&b);
+
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < numThreads; i++) {
+    workers.push_back(std::thread([&work, &done, stats]() {
+      Batch* b;
+      while (work.pop(&b)) {
+        b->out.clear();
+        b->emitted = 0;
+        for (size_t j = 0; j < b->size; j++) {
+          const BatchPage& page = b->pages[j];
+          b->emitted += processPage(page.title.c_str(), page.text.c_str(),
+                                    page.redirect, &b->out, stats);
+        }
+        done.push(b);
+      }
+    }));
+  }
 
-  std::string ret = str;
+  std::thread writer([&done, &idle, ordered, os, stats]() {
+    // batches which were finished before their predecessors
+    std::map<size_t, Batch*> pending;
+    size_t next = 0;
+    Batch* b;
+    while (done.pop(&b)) {
+      if (ordered) {
+        pending[b->id] = b;
+        while (pending.size() && pending.begin()->first == next) {
+          b = pending.begin()->second;
+          pending.erase(pending.begin());
+          writeOut(os, b->out, b->emitted, stats);
+          idle.push(b);
+          next++;
+        }
+      } else {
+        writeOut(os, b->out, b->emitted, stats);
+        idle.push(b);
+      }
+    }
+  });
 
-  std::vector<std::string> split;
+  Batch* cur = 0;
+  size_t id = 0;
+  size_t bytes = 0;
 
-  size_t last = 0;
-  while (last != std::string::npos) {
-    auto pos = ret.find('|', last + 1);
-    split.push_back(ret.substr(last, pos - last));
-    if (pos != std::string::npos) pos++;
-    last = pos;
-  }
+  auto finish = [&]() {
+    if (cur) work.push(cur);
+    work.close();
+    for (auto& w : workers) w.join();
+    done.close();
+    writer.join();
+  };
 
-  if (split.size() == 0) return "";
+  try {
+    Page page;
+    while (readPage(dump, &page, stats)) {
+      if (!cur) {
+        idle.pop(&cur);
+        cur->id = id++;
+        cur->size = 0;
+        bytes = 0;
+      }
 
-  size_t pos = split[0].find(':');
-  if (pos != std::string::npos) {
-    std::string type = split[0].substr(0, pos);
+      if (cur->pages.size() == cur->size) cur->pages.resize(cur->size + 1);
+      BatchPage& copy = cur->pages[cur->size++];
+      copy.title = page.title;
+      copy.text = page.text;
+      copy.redirect = page.redirect[0];
+      bytes += copy.text.size();
 
-    if (type == "File") return "";
-    if (type == "Image") return "";
-    if (type == "file") return "";
-    if (type == "image") return "";
+      if (cur->size == BATCH_PAGES || bytes >= BATCH_BYTES) {
+        work.push(cur);
+        cur = 0;
+      }
+    }
+  } catch (...) {
+    // output everything read so far before reporting the error
+    finish();
+    throw;
   }
 
-  if (split.size() == 1) {
-    size_t pos = split[0].find(':');
-    if (pos != std::string::npos) {
-      ret = ret.substr(pos + 1, std::string::npos);
+  finish();
+}
+
+// _____________________________________________________________________________
+void processShard(const std::string& path, const Config& cfg, size_t shard,
+                  size_t numShards, Output* os, pfxml::io_stats* ioStats,
+                  RunStats* stats) {
+  // process the pages starting in the byte range [shard * size / numShards,
+  // (shard + 1) * size / numShards) of the dump
+
+  pfxml::file xml(path, cfg.xmlOpts);
+  WikiDumpReader dump(&xml, cfg.ns);
+
+  if (numShards > 1) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+      throw pfxml::parse_exc("could not open file", path, 0, 0, 0);
     }
 
-    // wikipedia auto-hides stuff after comma
-    pos = ret.find(',');
-    if (pos != std::string::npos) {
-      ret = ret.substr(0, pos);
+    if (shard + 1 < numShards) {
+      dump.setEnd(st.st_size * (shard + 1) / numShards);
     }
+    if (shard > 0 && !dump.seek(st.st_size * shard / numShards)) return;
+  }
 
-    return parse(ret.c_str(), 1, true);
+  if (cfg.threads > 1) {
+    processParallel(&dump, cfg.threads, cfg.ordered, os, stats);
+  } else {
+    processSingle(&dump, os, stats);
   }
 
-  return parse(split.back().c_str(), 1, true);
+  ioStats->bytes += xml.stats().bytes;
+  ioStats->reads += xml.stats().reads;
+  ioStats->wait_ns += xml.stats().wait_ns;
 }
 
 // _____________________________________________________________________________
-std::pair<std::string, size_t> parseCrl(const char* str) {
-  // parse a template
-
-  if (strcmp(str, "disambiguation") == 0) return {"", 1};
-  if (strcmp(str, "DISAMBIGUATION") == 0) return {"", 1};
-  if (strcmp(str, "Disambiguation") == 0) return {"", 1};
-
-  if (strcmp(str, "human name disambiguation") == 0) return {"", 1};
-  if (strcmp(str, "HUMAN NAME DISAMBIGUATION") == 0) return {"", 1};
-  if (strcmp(str, "Human Name Disambiguation") == 0) return {"", 1};
-
-  std::vector<std::string> split;
-
-  size_t last = 0;
-  std::string ret = str;
-  while (last != std::string::npos) {
-    auto pos = ret.find('|', last + 1);
-    split.push_back(ret.substr(last, pos - last));
-    if (pos != std::string::npos) pos++;
-    last = pos;
+void processShards(const std::string& path, const Config& cfg, Output* os,
+                   pfxml::io_stats* ioStats, RunStats* stats) {
+  // process the dump in cfg.shards parallel shards. The first shard writes
+  // to os directly, the others to temporary files which are appended
+  // in order.
+
+  std::vector<std::thread> threads;
+  std::vector<int> tmpFiles(cfg.shards);
+  std::vector<std::exception_ptr> errors(cfg.shards);
+  std::vector<pfxml::io_stats> shardIoStats(cfg.shards);
+
+  const char* tmpDir = getenv("TMPDIR");
+  if (!tmpDir) tmpDir = "/tmp";
+
+  for (size_t i = 1; i < cfg.shards; i++) {
+    std::string tpl = std::string(tmpDir) + "/wikiabstracts-XXXXXX";
+    tmpFiles[i] = mkstemp(&tpl[0]);
+    if (tmpFiles[i] < 0) {
+      for (size_t j = 1; j < i; j++) close(tmpFiles[j]);
+      throw pfxml::parse_exc("could not create temporary file", tpl, 0, 0, 0);
+    }
+    // the file is removed as soon as it is closed
+    unlink(tpl.c_str());
   }
 
-  if (split.size() > 1) {
-    if (split[0] == "math") return {parse(split[1].c_str(), 1, false), 0};
+  for (size_t i = 0; i < cfg.shards; i++) {
+    threads.push_back(std::thread([&, i]() {
+      try {
+        if (i == 0) {
+          processShard(path, cfg, i, cfg.shards, os, &shardIoStats[i], stats);
+        } else {
+          Output tmp(tmpFiles[i], cfg.bufferSize, 0);
+          processShard(path, cfg, i, cfg.shards, &tmp, &shardIoStats[i], stats);
+          tmp.flush();
+          if (!tmp.good()) {
+            throw pfxml::parse_exc("could not write temporary file", tmpDir,
+                                   0, 0, 0);
+          }
+        }
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }));
   }
 
-  return {"", 0};
-}
+  // output stops after the first failed shard
+  std::exception_ptr err;
 
-// _____________________________________________________________________________
-std::string parseXml(const char* tag, const char* content) {
-  // parse xml found in the wikitext
+  for (size_t i = 0; i < cfg.shards; i++) {
+    threads[i].join();
+    if (i > 0) {
+      if (!err) {
+        lseek(tmpFiles[i], 0, SEEK_SET);
+        os->copy(tmpFiles[i]);
+      }
+      close(tmpFiles[i]);
+    }
+    if (!err) err = errors[i];
+
+    ioStats->bytes += shardIoStats[i].bytes;
+    ioStats->reads += shardIoStats[i].reads;
+    ioStats->wait_ns += shardIoStats[i].wait_ns;
+  }
 
-  if (strcmp(tag, "ref") == 0) return "";
-  if (strcmp(tag, "math") == 0) return content;
-  if (strcmp(tag, "var") == 0) return content;
-  return "";
+  if (err) std::rethrow_exception(err);
 }
 
 // _____________________________________________________________________________
-std::string parseBr(const char* str, bool woBr) {
-  if (woBr) return "";
-
-  std::stringstream ret;
-  // with a leading space!
-  ret << " (" << parse(str, 1, false) << ")";
-  return ret.str();
+int64_t inputBytes(const std::string& path, const Config& cfg) {
+  // the number of input bytes processed in total, -1 if unknown because
+  // the dump is compressed
+  struct stat st;
+  if (pfxml::file::is_bz2(path) || stat(path.c_str(), &st) != 0) return -1;
+  if (cfg.numShards == 1) return st.st_size;
+  return st.st_size * (cfg.shard + 1) / cfg.numShards -
+         st.st_size * cfg.shard / cfg.numShards;
 }
 
 // _____________________________________________________________________________
-std::string parse(const char* text, size_t maxParas, bool woBr) {
-  size_t pos = 0;
-  std::string ret;
-
-  TextStage s = LBEG;
-  size_t HEAD_D = 0;
-  size_t HEAD_D_ORIG = 0;
-  size_t SQ_D = 0;
-  size_t SSQ_D = 0;
-  size_t CRL_D = 0;
-  size_t TBL_D = 0;
-  size_t BR_D = 0;
-
-  std::string tmp;
-  std::string tmp2;
-
-  size_t paras = 0;
-
-  while (text[pos]) {
-    switch (s) {
-      case LBEG:
-        if (text[pos] == '\n') {
-          if (ret.size()) paras++;
-          if (paras >= maxParas) return ret;
-          pos++;
-          continue;
-        } else if (std::isspace(text[pos])) {
-          s = TEXT;
-          continue;
-        } else if (text[pos] == '=') {
-          s = IN_H;
-          HEAD_D += 1;
-          pos++;
-          continue;
-        } else if (text[pos] == '*' || text[pos] == '#' || text[pos] == ':' ||
-                   text[pos] == ';') {
-          if (strncmp(text + pos, "#REDIRECT", 9) == 0) return "";
-          if (strncmp(text + pos, "#redirect", 9) == 0) return "";
-          if (strncmp(text + pos, "#Redirect", 9) == 0) return "";
-          pos++;
-          continue;
-        }
-        s = TEXT;
-        continue;
-
-      case IN_H:
-        if (std::isspace(text[pos])) {
-          pos++;
-          continue;
-        } else if (text[pos] == '=') {
-          HEAD_D += 1;
-          pos++;
-          continue;
-        }
-
-        s = IN_H_TIT;
-        pos++;
-        continue;
-
-      case IN_H_TIT:
-        if (text[pos] == '=') {
-          HEAD_D_ORIG = HEAD_D;
-          HEAD_D -= 1;
-          s = IN_H_CL;
-          pos++;
-          continue;
-        }
-
-        pos++;
-        continue;
-
-      case IN_H_CL:
-        if (text[pos] == '=') {
-          HEAD_D -= 1;
-          if (HEAD_D == 0) {
-            return ret;
-          }
-          pos++;
-          continue;
-        } else {
-          // = wasn't the header closing, but part of the header
-          HEAD_D = HEAD_D_ORIG;
-          s = IN_H_TIT;
-          pos++;
-          continue;
-        }
-
-      case IN_TABLE:
-        if (text[pos] == '|' && text[pos + 1] == '}') {
-          pos += 2;
-          TBL_D--;
-          if (TBL_D == 0) s = TEXT;
-          continue;
-        } else if (text[pos] == '{' && text[pos + 1] == '|') {
-          s = IN_TABLE;
-          TBL_D++;
-          pos += 2;
-          continue;
-        }
-        pos++;
-        continue;
-
-      case IN_CURL:
-        if (text[pos] == '}' && text[pos + 1] == '}') {
-          auto crl = parseCrl(tmp.c_str());
-
-          // signal: abort!
-          if (crl.second == 1) return "";
-          ret += crl.first;
-          pos += 2;
-          CRL_D--;
-          if (CRL_D == 0) s = TEXT;
-          continue;
-        } else if (text[pos] == '{' && text[pos + 1] == '{') {
-          s = IN_CURL;
-          tmp += "{{";
-          CRL_D++;
-          pos += 2;
-          continue;
-        }
-        tmp += text[pos];
-        pos++;
-        continue;
-
-      case IN_SSQ:
-        if (text[pos] == ']') {
-          ret += parseSSq(tmp.c_str());
-          pos += 1;
-          SSQ_D--;
-          if (SSQ_D == 0) s = TEXT;
-          continue;
-        } else if (text[pos] == '[') {
-          s = IN_SSQ;
-          tmp += "[";
-          SSQ_D++;
-          pos += 1;
-          continue;
-        }
-        tmp += text[pos];
-        pos++;
-        continue;
-
-      case IN_SQ:
-        if (text[pos] == ']' && text[pos + 1] == ']') {
-          ret += parseSq(tmp.c_str());
-          pos += 2;
-          SQ_D--;
-          if (SQ_D == 0) s = TEXT;
-          continue;
-        } else if (text[pos] == '[' && text[pos + 1] == '[') {
-          s = IN_SQ;
-          tmp += "[[";
-          SQ_D++;
-          pos += 2;
-          continue;
-        }
-        tmp += text[pos];
-        pos++;
-        continue;
-
-      case IN_BR:
-        if (text[pos] == ')') {
-          // delete the space before the bracket
-          if (ret.back() == ' ') ret.resize(ret.size() - 1);
-          ret += parseBr(tmp.c_str(), woBr);
-          pos++;
-          BR_D--;
-          if (BR_D == 0) s = TEXT;
-          continue;
-        } else if (text[pos] == '(') {
-          s = IN_BR;
-          tmp += "(";
-          BR_D++;
-          pos++;
-          continue;
-        }
-        tmp += text[pos];
-        pos++;
-        continue;
-
-      case IN_TAG:
-        if (text[pos] == '<' && text[pos + 1] == '/') {
-          std::string locTmp;
-          size_t p = pos + 1;
-          while (text[p]) {
-            p++;
-            if (text[p] == '\n') {
-              s = TEXT;
-              tmp.clear();
-              tmp2.clear();
-              break;
-            } else if (text[p] == '>' || text[p] == 0) {
-              pos = p;
-              if (locTmp == tmp) {
-                ret += parseXml(tmp.c_str(), tmp2.c_str());
-                tmp.clear();
-                tmp2.clear();
-                pos = p + 1;
-                s = TEXT;
-                break;
-              }
-            } else {
-              locTmp += text[p];
-            }
-          }
-          continue;
-        } else {
-          tmp2 += text[pos];
-          pos++;
-          continue;
-        }
+bool parseIds(const char* str, std::vector<int>* ids) {
+  // parse a comma-separated list of namespace ids from MIN_NS to MAX_NS
+  while (true) {
+    char* end;
+    errno = 0;
+    long id = strtol(str, &end, 10);
+    if (end == str || errno || id < MIN_NS || id > MAX_NS) return false;
+    ids->push_back(id);
+    if (!*end) return true;
+    if (*end != ',') return false;
+    str = end + 1;
+  }
+}
 
-      case TEXT:
-        if (text[pos] == '\n') {
-          // avoid double spaces
-          if (ret.back() != ' ') ret += ' ';
-          pos++;
-          s = LBEG;
-          continue;
-        } else if (strncmp(text + pos, "__TOC__", 7) == 0) {
-          return ret;
-        } else if (strncmp(text + pos, "__FORCETOC__", 12) == 0) {
-          return ret;
-        } else if (strncmp(text + pos, "__NOTOC__", 9) == 0) {
-          pos += 9;
-          continue;
-        } else if (text[pos] == '\'') {
-          pos++;
-          continue;
-        } else if (text[pos] == '<' && text[pos + 1] == '!' &&
-                   text[pos + 2] == '-' && text[pos + 3] == '-') {
-          // comment
-          size_t p = pos + 3;
-          while (true) {
-            p++;
-            if (!text[p]) {
-              pos = p;
-              break;
-            } else if (text[p] == '-' && text[p + 1] == '-' &&
-                       text[p + 2] == '>') {
-              pos = p + 3;
-              break;
-            }
-          }
-          s = TEXT;
-          continue;
-        } else if (text[pos] == '<') {
-          s = IN_TAG;
-          tmp.clear();
-          tmp2.clear();
-          size_t p = pos;
-          while (text[p]) {
-            p++;
-            if (text[p] == '\n') {
-              s = TEXT;
-              tmp.clear();
-              tmp2.clear();
-              break;
-            } else if (text[p] == '>') {
-              pos = p;
-              tmp = tmp.substr(0, tmp.find(' '));
-              break;
-            } else if (text[p] == '/' && text[p + 1] == '>') {
-              pos = p + 1;
-              tmp.clear();
-              tmp2.clear();
-              s = TEXT;
-              break;
-            } else {
-              tmp += text[p];
-            }
-          }
+// _____________________________________________________________________________
+bool parseCount(const char* str, long max, size_t* val) {
+  // parse an integer from 0 to max
+  char* end;
+  errno = 0;
+  long n = strtol(str, &end, 10);
+  if (end == str || *end || errno || n < 0 || n > max) return false;
+  *val = n;
+  return true;
+}
 
-          pos++;
-          continue;
-        } else {
-          if (text[pos] == '{' && text[pos + 1] == '{') {
-            s = IN_CURL;
-            CRL_D = 1;
-            tmp.clear();
-            pos += 2;
-            continue;
-          } else if (text[pos] == '{' && text[pos + 1] == '|') {
-            s = IN_TABLE;
-            TBL_D = 1;
-            tmp.clear();
-            pos += 2;
-            continue;
-          } else if (text[pos] == '[' && text[pos + 1] == '[') {
-            s = IN_SQ;
-            SQ_D = 1;
-            tmp.clear();
-            pos += 2;
-            continue;
-          } else if (text[pos] == '[') {
-            s = IN_SSQ;
-            SSQ_D = 1;
-            tmp.clear();
-            pos += 1;
-            continue;
-          } else if (text[pos] == '(') {
-            s = IN_BR;
-            BR_D = 1;
-            tmp.clear();
-            pos += 1;
-            continue;
-          }
-        }
+// _____________________________________________________________________________
+bool parseMegabytes(const char* str, double max, size_t* bytes) {
+  // parse a size in MB from 0 to max, returns it in bytes
+  char* end;
+  errno = 0;
+  double mb = strtod(str, &end);
+  if (end == str || *end || errno || !(mb >= 0 && mb <= max)) return false;
+  *bytes = mb * 1024 * 1024;
+  return true;
+}
 
-        if (text[pos] != ' ' || ret.back() != ' ') ret += text[pos];
-        pos++;
-        continue;
-    }
-  }
+// _____________________________________________________________________________
+void printUsage(const char* bin) {
+  std::cout << "Usage: \n  " << bin << " [options] <wikipedia dump>\n\n"
+            << "Options:\n"
+            << "  --threads <N>  parse pages with N worker threads, 0 means one"
+               " per core\n"
+            << "                 (default: 1)\n"
+            << "  --unordered    with --threads, output abstracts as soon as"
+               " they are ready,\n"
+            << "                 not in dump order\n"
+            << "  --shard <I/N>  only process the I-th of N equally sized byte"
+               " ranges of\n"
+            << "                 the dump (0 <= I < N), the outputs of all"
+               " shards\n"
+            << "                 concatenate to the full output\n"
+            << "  --shards <N>   process N shards of the dump in parallel\n"
+            << "  --buffer-size <MB>\n"
+            << "                 size of the output buffer in MB (default: "
+            << OUTPUT_BUFFER_S / (1024 * 1024) << ")\n"
+            << "  --flush-every <N>\n"
+            << "                 flush the output after every N abstracts"
+               " (default: 1 if\n"
+            << "                 stdout is a terminal, otherwise only when the"
+               " buffer is\n"
+            << "                 full)\n"
+            << "  --mmap         read uncompressed dumps via a memory"
+               " mapping\n"
+            << "  --no-readahead do not read the dump ahead in a background"
+               " thread\n"
+            << "  --io-stats     print input statistics to stderr at the"
+               " end\n"
+            << "  --mem-stats    print the scratch memory used per page to"
+               " stderr at the end\n"
+            << "  --stats        print the progress to stderr every "
+            << PROGRESS_INTERVAL_S << " seconds, and\n"
+            << "                 a summary (also as JSON) at the end\n"
+            << "  --slowest <N>  like --stats, and list the N pages which"
+               " took longest to\n"
+            << "                 parse (default: " << SLOWEST_PAGES << ")\n"
+            << "  --index <file> index of a bzip2 multistream dump (default:"
+               " searched next\n"
+            << "                 to the dump)\n"
+            << "  --ns <IDS>     only output pages in the namespaces with the"
+               " comma-separated\n"
+            << "                 ids (default: all but user, project, file,"
+               " template, ...)\n"
+            << "  --drop-ns <IDS>\n"
+            << "                 additionally drop pages in the namespaces with"
+               " the comma-\n"
+            << "                 separated ids\n"
+            << "  --bz2-threads <N>\n"
+            << "                 decompress multistream dumps with N threads,"
+               " 0 means one\n"
+            << "                 per core (default: 0)\n"
+            << "  --help         show this help" << std::endl;
+}
 
-  if (paras > 1) return parse(text, 1, woBr);
-  return ret;
+// _____________________________________________________________________________
+int invalidValue(const char* bin, const char* opt, const char* val) {
+  std::cerr << "Invalid value '" << val << "' for " << opt << ".\n\n";
+  printUsage(bin);
+  return static_cast<int>(RetCode::INVALID_ARGUMENT);
 }
 
 // _____________________________________________________________________________
 int main(int argc, char** argv) {
-  // disable output buffering for standard output
-  setbuf(stdout, NULL);
-
   // initialize randomness
   srand(time(NULL) + rand());  // NOLINT
 
-  if (argc < 2) {
+  std::string path;
+  Config cfg;
+
+  // interactive use
+  if (isatty(STDOUT_FILENO)) cfg.flushEvery = 1;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--help")) {
+      printUsage(argv[0]);
+      return static_cast<int>(RetCode::SUCCESS);
+    } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+      if (!parseCount(argv[++i], MAX_THREADS, &cfg.threads)) {
+        return invalidValue(argv[0], argv[i - 1], argv[i]);
+      }
+      if (cfg.threads == 0) cfg.threads = std::thread::hardware_concurrency();
+      if (cfg.threads == 0) cfg.threads = 1;
+    } else if (!strcmp(argv[i], "--unordered")) {
+      cfg.ordered = false;
+    } else if (!strcmp(argv[i], "--shard") && i + 1 < argc) {
+      if (sscanf(argv[++i], "%zu/%zu", &cfg.shard, &cfg.numShards) != 2 ||
+          cfg.numShards == 0 || cfg.shard >= cfg.numShards) {
+        std::cerr << "Invalid shard '" << argv[i] << "', expected I/N with"
+                  << " 0 <= I < N.\n";
+        return static_cast<int>(RetCode::INVALID_ARGUMENT);
+      }
+    } else if (!strcmp(argv[i], "--shards") && i + 1 < argc) {
+      if (!parseCount(argv[++i], MAX_THREADS, &cfg.shards)) {
+        return invalidValue(argv[0], argv[i - 1], argv[i]);
+      }
+      if (cfg.shards == 0) cfg.shards = 1;
+    } else if (!strcmp(argv[i], "--buffer-size") && i + 1 < argc) {
+      if (!parseMegabytes(argv[++i], MAX_BUFFER_MB, &cfg.bufferSize)) {
+        return invalidValue(argv[0], argv[i - 1], argv[i]);
+      }
+      if (cfg.bufferSize == 0) cfg.bufferSize = 1;
+    } else if (!strcmp(argv[i], "--flush-every") && i + 1 < argc) {
+      if (!parseCount(argv[++i], LONG_MAX, &cfg.flushEvery)) {
+        return invalidValue(argv[0], argv[i - 1], argv[i]);
+      }
+    } else if (!strcmp(argv[i], "--index") && i + 1 < argc) {
+      cfg.xmlOpts.index = argv[++i];
+    } else if (!strcmp(argv[i], "--no-readahead")) {
+      cfg.xmlOpts.readahead = false;
+    } else if (!strcmp(argv[i], "--io-stats")) {
+      cfg.ioStats = true;
+    } else if (!strcmp(argv[i], "--mem-stats")) {
+      cfg.memStats = true;
+    } else if (!strcmp(argv[i], "--stats")) {
+      cfg.stats = true;
+    } else if (!strcmp(argv[i], "--slowest") && i + 1 < argc) {
+      cfg.stats = true;
+      if (!parseCount(argv[++i], MAX_SLOWEST, &cfg.slowest)) {
+        return invalidValue(argv[0], argv[i - 1], argv[i]);
+      }
+    } else if (!strcmp(argv[i], "--mmap")) {
+      cfg.xmlOpts.mmap = true;
+    } else if ((!strcmp(argv[i], "--ns") || !strcmp(argv[i], "--drop-ns")) &&
+               i + 1 < argc) {
+      std::vector<int> ids;
+      if (!parseIds(argv[i + 1], &ids)) {
+        std::cerr << "Invalid namespace ids '" << argv[i + 1] << "', expected"
+                  << " a comma-separated list of integers from " << MIN_NS
+                  << " to " << MAX_NS << ".\n";
+        return static_cast<int>(RetCode::INVALID_ARGUMENT);
+      }
+      if (!strcmp(argv[i], "--ns")) {
+        cfg.ns.useOnly(ids);
+      } else {
+        for (int id : ids) cfg.ns.drop(id);
+      }
+      i++;
+    } else if (!strcmp(argv[i], "--bz2-threads") && i + 1 < argc) {
+      if (!parseCount(argv[++i], MAX_THREADS, &cfg.xmlOpts.threads)) {
+        return invalidValue(argv[0], argv[i - 1], argv[i]);
+      }
+    } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+      std::cerr << "Unknown option '" << argv[i] << "'.\n\n";
+      printUsage(argv[0]);
+      return static_cast<int>(RetCode::INVALID_ARGUMENT);
+    } else {
+      path = argv[i];
+    }
+  }
+
+  if (path.empty()) {
     std::cerr << "No Wikipedia dump XML file given.\n\n";
+    printUsage(argv[0]);
+    return static_cast<int>(RetCode::MISSING_WIKI_DUMP);
   }
 
-  if (argc < 2 || !strcmp(argv[1], "--help")) {
-    std::cout << "Usage: \n  " << argv[0] << " <wikipedia dump>" << std::endl;
-    return static_cast<int>(argc < 2 ? RetCode::MISSING_WIKI_DUMP
-                                     : RetCode::SUCCESS);
+  if (cfg.shards > 1 && cfg.numShards > 1) {
+    std::cerr << "--shard and --shards cannot be combined.\n";
+    return static_cast<int>(RetCode::INVALID_ARGUMENT);
   }
 
-  try {
-  pfxml::file xml(argv[1]);
+  // shards start at byte offsets, which compressed dumps cannot seek to
+  if ((cfg.shards > 1 || cfg.numShards > 1) && pfxml::file::is_bz2(path)) {
+    std::cerr << (cfg.shards > 1 ? "--shards" : "--shard")
+              << " needs an uncompressed dump, '" << path
+              << "' is bzip2-compressed.\n";
+    return static_cast<int>(RetCode::INVALID_ARGUMENT);
+  }
 
-  size_t stage = 0;
+  if (cfg.memStats) collectScratchStats();
 
-  std::string title;
+  Output out(STDOUT_FILENO, cfg.bufferSize, cfg.flushEvery);
+  pfxml::io_stats ioStats;
 
-  while (xml.next()) {
-    const auto& cur = xml.get();
-    if (xml.level() == 2 && strcmp(cur.name, "page") == 0) {
-      stage = 1;
-    } else if (stage == 1) {
-      if (xml.level() == 3 && strcmp(cur.name, "title") == 0) {
-        xml.next();
-        const auto& textEl = xml.get();
-        title = textEl.text;
-      } else if (xml.level() == 3 && strcmp(cur.name, "revision") == 0) {
-        stage = 2;
-      }
-    } else if (stage == 2) {
-      if (xml.level() == 4 && strcmp(cur.name, "text") == 0) {
-        xml.next();
-        const auto& textEl = xml.get();
-        auto abstr = pfxml::file::decode(parse(textEl.text, 10, true).c_str());
-
-        // decode two times, because the decoded text may be XML again...
-        abstr = pfxml::file::decode(abstr);
-        abstr = parse(abstr.c_str(), 10, false);
-
-        // output if page is used
-        if (abstr.size() && usePage(title)) {
-          std::cout << pfxml::file::decode(title) << '\t' << abstr << "\n";
-        }
+  RunStats runStats(cfg.slowest);
+  RunStats* stats = cfg.stats ? &runStats : 0;
+
+  {
+    // reports the progress until the end of the scope
+    std::unique_ptr<ProgressReporter> progress;
+    if (stats) {
+      progress.reset(new ProgressReporter(stats, inputBytes(path, cfg)));
+    }
+
+    try {
+      if (cfg.shards > 1) {
+        processShards(path, cfg, &out, &ioStats, stats);
+      } else {
+        processShard(path, cfg, cfg.shard, cfg.numShards, &out, &ioStats,
+                     stats);
       }
+    } catch (const pfxml::parse_exc& e) {
+      out.flush();
+      std::cerr << e.what() << std::endl;
+      return static_cast <int>(RetCode::PARSE_ERROR);
     }
+
+    out.flush();
+  }
+
+  if (cfg.ioStats) {
+    std::cerr << "Read " << ioStats.bytes << " bytes in " << ioStats.reads
+              << " buffer refills, waited " << ioStats.wait_ns / 1000000
+              << " ms for input data." << std::endl;
   }
-  } catch (const pfxml::parse_exc& e) {
-    std::cerr << e.what() << std::endl;
-    return static_cast <int>(RetCode::PARSE_ERROR);
+
+  if (cfg.memStats) {
+    ScratchStats st = scratchStats();
+    std::cerr << "Parsed " << st.pages << " pages with at most "
+              << st.maxPageBytes << " bytes (mean "
+              << (st.pages ? st.sumPageBytes / st.pages : 0)
+              << ") of scratch memory per page, largest arena "
+              << st.maxArenaBytes << " bytes." << std::endl;
+  }
+
+  if (!out.good()) {
+    std::cerr << "Could not write output." << std::endl;
+    return static_cast<int>(RetCode::OUTPUT_ERROR);
   }
 
   return static_cast<int>(RetCode::SUCCESS);
@@ -0,0 +1,149 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <cstdlib>
+#include <cstring>
+#include "WikiDumpReader.h"
+
+// namespace of the root element of dumps following the export schema
+static const char* EXPORT_NS = "http://www.mediawiki.org/xml/export-";
+
+// _____________________________________________________________________________
+WikiDumpReader::WikiDumpReader(pfxml::file* xml, const Namespaces& ns)
+    : _xml(xml),
+      _ns(ns),
+      _end(-1),
+      _base(0),
+      _schema(false),
+      _fresh(true),
+      _done(false),
+      _skipRevision(false),
+      _stage(0),
+      _id(-1),
+      _pageNs(0),
+      _hasNs(false) {
+  // <mediawiki xmlns="http://www.mediawiki.org/xml/export-0.10/" ...>
+  if (_xml->next()) {
+    const char* xmlns = _xml->get().attr("xmlns");
+    _schema = strcmp(_xml->get().name, "mediawiki") == 0 && xmlns &&
+              strncmp(xmlns, EXPORT_NS, strlen(EXPORT_NS)) == 0;
+    _xml->next();
+    _ns.read(_xml);
+  }
+}
+
+// _____________________________________________________________________________
+bool WikiDumpReader::seek(int64_t off) {
+  // the found page is taken to be a child of the open element, so leave the
+  // current page first
+  if (_xml->level() == 2 && strcmp(_xml->get().name, "page") == 0) {
+    _xml->skip("page");
+  }
+
+  _fresh = true;
+  _skipRevision = false;
+  _stage = 0;
+  _stats = DumpStats();
+  _base = off;
+  return _xml->seek(off, "page");
+}
+
+// _____________________________________________________________________________
+void WikiDumpReader::setEnd(int64_t end) { _end = end; }
+
+// _____________________________________________________________________________
+const Namespaces& WikiDumpReader::namespaces() const { return _ns; }
+
+// _____________________________________________________________________________
+DumpStats WikiDumpReader::stats() const {
+  DumpStats ret = _stats;
+  ret.bytes = _xml->consumed() - _base;
+  return ret;
+}
+
+// _____________________________________________________________________________
+bool WikiDumpReader::next(Page* page) {
+  if (_done) return false;
+
+  if (_skipRevision) {
+    _skipRevision = false;
+    _xml->skip("revision");
+  }
+
+  // after the construction or a seek, the reader is already positioned on
+  // the first page
+  bool more = (_fresh && _xml->get().name) || _xml->next();
+  _fresh = false;
+
+  for (; more; more = _xml->next()) {
+    const auto& cur = _xml->get();
+    size_t level = _xml->level();
+
+    if (level == 2 && strcmp(cur.name, "page") == 0) {
+      if (_end >= 0 && _xml->offset() >= _end) break;
+      _stats.pages++;
+      _stage = 1;
+      _id = -1;
+      _hasNs = false;
+      _title.clear();
+      _redirect.clear();
+    } else if (_stage == 1 && level == 3) {
+      if (strcmp(cur.name, "title") == 0) {
+        _xml->next();
+        _title = _xml->get().text;
+      } else if (strcmp(cur.name, "ns") == 0) {
+        _xml->next();
+        _pageNs = atoi(_xml->get().text);
+        _hasNs = true;
+        // skip the revisions of dropped pages without tokenizing them
+        if (!_ns.use(_pageNs)) {
+          _stats.droppedNs++;
+          _xml->skip("page");
+          _stage = 0;
+        }
+      } else if (strcmp(cur.name, "id") == 0) {
+        _xml->next();
+        _id = strtoll(_xml->get().text, 0, 10);
+      } else if (strcmp(cur.name, "redirect") == 0) {
+        const char* target = cur.attr("title");
+        _redirect = target ? target : "";
+      } else if (strcmp(cur.name, "revision") == 0) {
+        // older dumps have no <ns>, the namespace is the title prefix
+        if (!_hasNs) _pageNs = _ns.id(_title);
+        if (!_hasNs && !_ns.use(_pageNs)) {
+          _stats.droppedNs++;
+          _xml->skip("page");
+          _stage = 0;
+        } else {
+          _stage = 2;
+          // the <text> follows the revision metadata
+          if (_schema) _xml->jump("text", "</revision>");
+        }
+      }
+    } else if (_stage == 2) {
+      if (level == 3 && strcmp(cur.name, "revision") == 0) {
+        if (_schema) _xml->jump("text", "</revision>");
+      } else if (level == 4 && strcmp(cur.name, "text") == 0) {
+        _xml->next();
+        page->id = _id;
+        page->ns = _pageNs;
+        page->title = _title.c_str();
+        page->redirect = _redirect.c_str();
+        page->text = _xml->get().text;
+
+        if (_xml->get().name[0]) {
+          // the text was empty, look at the tag following it next time
+          page->text = "";
+          _fresh = true;
+        } else {
+          _skipRevision = _schema;
+        }
+        return true;
+      }
+    }
+  }
+
+  _done = true;
+  return false;
+}
@@ -0,0 +1,94 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#ifndef WIKIDUMPREADER_H_
+#define WIKIDUMPREADER_H_
+
+#include <string>
+#include "Namespaces.h"
+#include "pfxml.h"
+
+// a page of a dump. All strings are still XML-escaped and only valid until
+// the next call of WikiDumpReader::next(). The text points into the buffer
+// of the XML file, the title and redirect are copied as they are read long
+// before the text.
+struct Page {
+  // -1 if the page has no <id>
+  int64_t id;
+  // from the title prefix in dumps without <ns>
+  int ns;
+  const char* title;
+  // the target of a redirect page, empty otherwise
+  const char* redirect;
+  // the wikitext of a revision, pages with several revisions are returned
+  // once per revision
+  const char* text;
+};
+
+// what the reader has gone through so far
+struct DumpStats {
+  DumpStats() : bytes(0), pages(0), droppedNs(0) {}
+  // input bytes since the start or the seek position
+  int64_t bytes;
+  // <page> elements
+  size_t pages;
+  // pages skipped because of their namespace
+  size_t droppedNs;
+};
+
+// reads the pages of a MediaWiki XML dump. In dumps of the MediaWiki export
+// schema, the revision metadata is skipped without tokenizing it, only the
+// page header and <text> are read tag by tag.
+class WikiDumpReader {
+ public:
+  // read the root element and the <siteinfo> of the dump, pages in the
+  // namespaces not used by ns are skipped
+  WikiDumpReader(pfxml::file* xml, const Namespaces& ns);
+
+  // continue at the first page starting at or after byte offset off,
+  // returns false if there is none
+  bool seek(int64_t off);
+
+  // stop at the first page starting at or after byte offset end
+  void setEnd(int64_t end);
+
+  // the next page in a used namespace, false at the end of the dump
+  bool next(Page* page);
+
+  // the namespaces, including the names read from the <siteinfo>
+  const Namespaces& namespaces() const;
+
+  DumpStats stats() const;
+
+ private:
+  pfxml::file* _xml;
+  Namespaces _ns;
+  int64_t _end;
+
+  DumpStats _stats;
+  // input offset where _stats.bytes is 0
+  int64_t _base;
+
+  // the dump follows the MediaWiki export schema
+  bool _schema;
+
+  // the reader is positioned on a tag which was not looked at yet
+  bool _fresh;
+  bool _done;
+
+  // the rest of the revision of the last returned page is to be skipped
+  bool _skipRevision;
+
+  // the page being read, 0 outside of pages, 1 in its header, 2 in a
+  // revision
+  size_t _stage;
+
+  int64_t _id;
+  int _pageNs;
+  bool _hasNs;
+  std::string _title;
+  std::string _redirect;
+};
+
+#endif  // WIKIDUMPREADER_H_
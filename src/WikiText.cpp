@@ -0,0 +1,1130 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <vector>
+#include "Arena.h"
+#include "RunStats.h"
+#include "Templates.h"
+#include "TextScan.h"
+#include "WikiText.h"
+#include "pfxml.h"
+
+enum TextStage {
+  LBEG,
+  TEXT,
+  IN_CURL,
+  IN_SQ,
+  IN_SSQ,
+  IN_BR,
+  IN_H,
+  IN_H_TIT,
+  IN_H_CL,
+  IN_TAG
+};
+
+// _____________________________________________________________________________
+static size_t openerKey(size_t pos, TextStage kind) {
+  // an opener of a link, bracket or template at pos, ordered by position
+  return pos << 2 | (kind - IN_CURL);
+}
+
+// scratch buffers of a parse() or handler call, one per recursion depth. They
+// live in the arena of the thread, which is reset after each page.
+struct Scratch {
+  ArenaString tmp;
+  ArenaString tmp2;
+  ArenaString head;
+  // the openers nested in the construct in tmp which are not closed yet,
+  // and the openerKey()s of the openers found not to be closed, sorted
+  ArenaVector<size_t> opens;
+  ArenaVector<size_t> notClosed;
+};
+
+static thread_local std::vector<Scratch*> scratchPool;
+static thread_local size_t scratchDepth = 0;
+static thread_local size_t parseDepth = 0;
+
+// a template handler dropped the page since the last abstract()
+static thread_local bool dropped = false;
+
+static bool collectStats = false;
+static std::atomic<size_t> statPages(0);
+static std::atomic<size_t> statSumPageBytes(0);
+static std::atomic<size_t> statMaxPageBytes(0);
+static std::atomic<size_t> statMaxArenaBytes(0);
+
+// _____________________________________________________________________________
+static void atomicMax(std::atomic<size_t>* a, size_t val) {
+  size_t cur = a->load();
+  while (cur < val && !a->compare_exchange_weak(cur, val)) {
+  }
+}
+
+// _____________________________________________________________________________
+static void endPage() {
+  // the outermost call returns, release all scratch memory of the page
+  Arena* arena = threadArena();
+  if (collectStats) {
+    statPages++;
+    statSumPageBytes += arena->used();
+    atomicMax(&statMaxPageBytes, arena->used());
+    atomicMax(&statMaxArenaBytes, arena->capacity());
+  }
+  scratchPool.clear();
+  arena->reset();
+}
+
+// the scratch buffers of the current recursion depth
+class ScratchScope {
+ public:
+  ScratchScope() {
+    if (scratchDepth == scratchPool.size()) {
+      void* mem = threadArena()->alloc(sizeof(Scratch));
+      scratchPool.push_back(new (mem) Scratch());
+    }
+    _s = scratchPool[scratchDepth++];
+  }
+  ~ScratchScope() {
+    if (--scratchDepth == 0) endPage();
+  }
+
+  Scratch* operator->() const { return _s; }
+
+ private:
+  Scratch* _s;
+};
+
+// counts the nested parse() calls of the thread
+class ParseDepthScope {
+ public:
+  ParseDepthScope() { parseDepth++; }
+  ~ParseDepthScope() { parseDepth--; }
+};
+
+// the end of a line, and the last '>' on it
+struct LineInfo {
+  size_t end;
+  // 0 if there is none
+  size_t lastGt;
+};
+
+// _____________________________________________________________________________
+static LineInfo lineInfo(const char* text, size_t pos) {
+  // the end of the line at pos (its \n or the end of text), and the last '>'
+  // from pos on. Tags are searched for at most up to the end of a line, so
+  // the tag scans of parse() look this up once per line.
+  LineInfo ret;
+  size_t len = strcspn(text + pos, "\n");
+  ret.end = pos + len;
+  const void* gt = memrchr(text + pos, '>', len);
+  ret.lastGt = gt ? static_cast<const char*>(gt) - text : 0;
+  return ret;
+}
+
+// _____________________________________________________________________________
+static size_t pieceEnd(const char* str, size_t len, size_t beg, char sep) {
+  // end of the piece of str starting at beg, when splitting at sep outside
+  // of nested links and templates. As before, a separator directly at beg
+  // does not end the piece.
+  const char stops[] = {'{', '}', '[', ']', sep, 0};
+  size_t depth = 0;
+  for (size_t i = beg; i < len; i++) {
+    i += strcspn(str + i, stops);
+    char c = str[i];
+    if ((c == '{' || c == '[') && str[i + 1] == c) {
+      depth++;
+      i++;
+    } else if ((c == '}' || c == ']') && str[i + 1] == c) {
+      if (depth) depth--;
+      i++;
+    } else if (!depth && c == sep && i > beg) {
+      return i;
+    }
+  }
+  return len;
+}
+
+// _____________________________________________________________________________
+static size_t lastPiece(const char* str, size_t len, char sep) {
+  // start of the last piece of str, when splitting at sep
+  size_t beg = 0;
+  for (size_t end; (end = pieceEnd(str, len, beg, sep)) < len;) beg = end + 1;
+  return beg;
+}
+
+// _____________________________________________________________________________
+static bool rendered(const char* body) {
+  // the template whose body (after the {{) starts at body has a handler. A
+  // name with nested markup never has one, and unclosed templates are never
+  // passed to a handler either.
+  size_t n = strcspn(body, "|{}");
+  if (body[n] != '|' && !(body[n] == '}' && body[n + 1] == '}')) return false;
+  return templates()->get(body, n) != nullptr;
+}
+
+// _____________________________________________________________________________
+static bool skipTemplate(const char* text, size_t* pos,
+                         ArenaVector<size_t>* opens) {
+  // move pos from the body of a template to after the }} closing it. Nested
+  // {{ and }} are counted exactly as in the IN_CURL state of parse(). Returns
+  // false if the template is not closed, pos is then the end of text and
+  // opens holds the nested openers which are not closed either.
+  size_t depth = 1;
+  opens->clear();
+  while (true) {
+    *pos += strcspn(text + *pos, "{}");
+    if (!text[*pos]) return false;
+    if (text[*pos] == '}' && text[*pos + 1] == '}') {
+      *pos += 2;
+      if (--depth == 0) return true;
+      opens->pop_back();
+    } else if (text[*pos] == '{' && text[*pos + 1] == '{') {
+      opens->push_back(*pos);
+      depth++;
+      *pos += 2;
+    } else {
+      (*pos)++;
+    }
+  }
+}
+
+// _____________________________________________________________________________
+static size_t skipUnclosedTemplate(const char* text, size_t pos) {
+  // the end of the parameters of the unclosed template whose body starts at
+  // pos: the rest of its line, and the following lines starting with | or },
+  // as in a template with one parameter per line. Returns the position of
+  // the \n after them, or the end of text.
+  while (true) {
+    pos += strcspn(text + pos, "\n");
+    if (!text[pos]) return pos;
+    size_t next = pos + 1 + strspn(text + pos + 1, " \t");
+    if (text[next] != '|' && text[next] != '}') return pos;
+    pos = next;
+  }
+}
+
+// _____________________________________________________________________________
+static size_t skipTable(const char* text, size_t pos) {
+  // the position after the |} closing the table whose body starts at pos, or
+  // the end of text. Nested tables are counted.
+  size_t depth = 1;
+  while (true) {
+    pos += tableRun(text + pos);
+    if (!text[pos]) return pos;
+    if (text[pos] == '|' && text[pos + 1] == '}') {
+      pos += 2;
+      if (--depth == 0) return pos;
+    } else if (text[pos] == '{' && text[pos + 1] == '|') {
+      depth++;
+      pos += 2;
+    } else {
+      pos++;
+    }
+  }
+}
+
+// _____________________________________________________________________________
+template <typename Str>
+static void appendParsed(const char* text, size_t maxParas, bool woBr,
+                         Str* out) {
+  ScratchScope sc;
+  parse(text, maxParas, woBr, &sc->tmp);
+  out->append(sc->tmp.data(), sc->tmp.size());
+}
+
+// _____________________________________________________________________________
+template <typename Str>
+void parseSSq(const char* str, Str* out) {
+  // parse a single squared command like [http://google.de], usually used
+  // for external links
+
+  // the last of the pieces separated by spaces
+  appendParsed(str + lastPiece(str, strlen(str), ' '), 1, true, out);
+}
+
+// _____________________________________________________________________________
+template <typename Str>
+void parseSq(const char* str, Str* out) {
+  // parse a double squared command like [[Freiburg im Breisgau]], usually used
+  // for internal links
+
+  size_t len = strlen(str);
+  size_t firstEnd = pieceEnd(str, len, 0, '|');
+
+  const char* colon = static_cast<const char*>(memchr(str, ':', firstEnd));
+  if (colon) {
+    size_t typeLen = colon - str;
+    if (typeLen == 4 && strncmp(str, "File", 4) == 0) return;
+    if (typeLen == 5 && strncmp(str, "Image", 5) == 0) return;
+    if (typeLen == 4 && strncmp(str, "file", 4) == 0) return;
+    if (typeLen == 5 && strncmp(str, "image", 5) == 0) return;
+  }
+
+  if (firstEnd == len) {
+    const char* beg = colon ? colon + 1 : str;
+
+    // wikipedia auto-hides stuff after comma
+    const char* comma = strchr(beg, ',');
+    if (comma) {
+      ScratchScope sc;
+      sc->tmp.assign(beg, comma - beg);
+      appendParsed(sc->tmp.c_str(), 1, true, out);
+      return;
+    }
+
+    appendParsed(beg, 1, true, out);
+    return;
+  }
+
+  // the last of the pieces separated by |
+  appendParsed(str + lastPiece(str, len, '|'), 1, true, out);
+}
+
+// _____________________________________________________________________________
+template <typename Str>
+bool parseCrl(const char* str, Str* out) {
+  // parse a template, returns false if the whole page should be dropped
+
+  // most templates are not rendered, look them up before splitting them.
+  // A name with nested markup never has a handler, so the name ends at the
+  // first |.
+  const char* bar = strchr(str, '|');
+  TemplateHandler handler =
+      templates()->get(str, bar ? bar - str : strlen(str));
+  if (!handler) return true;
+
+  TemplateCall call(str);
+  ScratchScope sc;
+  sc->tmp.clear();
+  if (!handler(call, &sc->tmp)) {
+    dropped = true;
+    return false;
+  }
+  out->append(sc->tmp.data(), sc->tmp.size());
+  return true;
+}
+
+// _____________________________________________________________________________
+template <typename Str>
+void parseXml(const char* tag, const char* content, Str* out) {
+  // parse xml found in the wikitext
+
+  if (strcmp(tag, "math") == 0) *out += content;
+  if (strcmp(tag, "var") == 0) *out += content;
+}
+
+// _____________________________________________________________________________
+template <typename Str>
+void parseBr(const char* str, bool woBr, Str* out) {
+  if (woBr) return;
+
+  // with a leading space!
+  *out += " (";
+  appendParsed(str, 1, false, out);
+  *out += ")";
+}
+
+// _____________________________________________________________________________
+std::string parse(const char* text, size_t maxParas, bool woBr) {
+  std::string ret;
+  parse(text, maxParas, woBr, &ret);
+  return ret;
+}
+
+// _____________________________________________________________________________
+template <typename Str>
+void parse(const char* text, size_t maxParas, bool woBr, Str* out) {
+  size_t pos = 0;
+  Str& ret = *out;
+  ret.clear();
+
+  if (parseDepth == MAX_PARSE_DEPTH) return;
+  ParseDepthScope depth;
+
+  TextStage s = LBEG;
+  size_t HEAD_D = 0;
+  size_t HEAD_D_ORIG = 0;
+  size_t SQ_D = 0;
+  size_t SSQ_D = 0;
+  size_t CRL_D = 0;
+  size_t BR_D = 0;
+
+  ScratchScope sc;
+  ArenaString& tmp = sc->tmp;
+  ArenaString& tmp2 = sc->tmp2;
+  tmp.clear();
+  tmp2.clear();
+
+  size_t paras = 0;
+
+  // the construct in tmp was opened here
+  size_t open = 0;
+
+  // the content of the construct is longer than MAX_CONSTRUCT_S, it is not
+  // buffered any further and dropped when it is closed
+  bool overlong = false;
+  auto buffer = [&](const char* str, size_t n) {
+    if (tmp.size() + n > MAX_CONSTRUCT_S) {
+      overlong = true;
+      return;
+    }
+    tmp.append(str, n);
+  };
+
+  // the line the last tag scan was on
+  LineInfo line = {0, 0};
+
+  // openers which are not closed are dropped, and the text after them is
+  // parsed as usual. Only unclosed templates also drop their parameters, see
+  // skipUnclosedTemplate(). Unclosed openers are known after a construct was
+  // not closed, up to failedUntil[<its state>]. If another opener of the
+  // kind before that is not closed either, all of them are dropped up to
+  // plainUntil[<its state>], so no byte is parsed again more than twice per
+  // kind.
+  ArenaVector<size_t>& opens = sc->opens;
+  ArenaVector<size_t>& notClosed = sc->notClosed;
+  opens.clear();
+  notClosed.clear();
+  size_t failedUntil[IN_H] = {0};
+  size_t plainUntil[IN_H] = {0};
+
+  // the first of notClosed not before pos, which only grows until the next
+  // construct is not closed
+  size_t nextNotClosed = 0;
+
+  auto plain = [&](TextStage kind) {
+    while (nextNotClosed < notClosed.size() &&
+           notClosed[nextNotClosed] >> 2 < pos)
+      nextNotClosed++;
+    for (size_t i = nextNotClosed;
+         i < notClosed.size() && notClosed[i] >> 2 == pos; i++) {
+      if (notClosed[i] == openerKey(pos, kind)) return true;
+    }
+    return pos < plainUntil[kind];
+  };
+
+  // the construct opened at open is not closed, parse again from there
+  auto unclosed = [&]() {
+    if (open < failedUntil[s]) {
+      plainUntil[s] = pos;
+    } else {
+      // parsing goes on from open, the openers before are not needed again
+      notClosed.erase(notClosed.begin(),
+                      notClosed.begin() + nextNotClosed);
+      notClosed.push_back(openerKey(open, s));
+      for (size_t o : opens) notClosed.push_back(openerKey(o, s));
+      std::sort(notClosed.begin(), notClosed.end());
+      nextNotClosed = 0;
+    }
+    failedUntil[s] = pos;
+    pos = open;
+    s = TEXT;
+    line.end = 0;
+  };
+
+  // if the text ends after more than one paragraph, the abstract is only the
+  // first one. Remember where it ended instead of parsing again.
+  size_t firstPara = 0;
+  ArenaString& firstParaHead = sc->head;
+  firstParaHead.clear();
+
+  while (true) {
+    if (!text[pos]) {
+      if (s != IN_CURL && s != IN_SQ && s != IN_SSQ && s != IN_BR) break;
+      unclosed();
+    }
+
+    switch (s) {
+      case LBEG:
+        if (text[pos] == '\n') {
+          if (ret.size() && ++paras == 1) firstPara = ret.size();
+          if (paras >= maxParas) return;
+          pos++;
+          continue;
+        } else if (pfxml::is_space(text[pos])) {
+          s = TEXT;
+          continue;
+        } else if (text[pos] == '=') {
+          s = IN_H;
+          HEAD_D += 1;
+          pos++;
+          continue;
+        } else if (text[pos] == '*' || text[pos] == '#' || text[pos] == ':' ||
+                   text[pos] == ';') {
+          if (strncmp(text + pos, "#REDIRECT", 9) == 0) {
+            ret.clear();
+            return;
+          }
+          if (strncmp(text + pos, "#redirect", 9) == 0) {
+            ret.clear();
+            return;
+          }
+          if (strncmp(text + pos, "#Redirect", 9) == 0) {
+            ret.clear();
+            return;
+          }
+          pos++;
+          continue;
+        }
+        s = TEXT;
+        continue;
+
+      case IN_H:
+        if (pfxml::is_space(text[pos])) {
+          pos++;
+          continue;
+        } else if (text[pos] == '=') {
+          HEAD_D += 1;
+          pos++;
+          continue;
+        }
+
+        s = IN_H_TIT;
+        pos++;
+        continue;
+
+      case IN_H_TIT:
+        if (text[pos] == '=') {
+          HEAD_D_ORIG = HEAD_D;
+          HEAD_D -= 1;
+          s = IN_H_CL;
+          pos++;
+          continue;
+        }
+
+        pos++;
+        continue;
+
+      case IN_H_CL:
+        if (text[pos] == '=') {
+          HEAD_D -= 1;
+          if (HEAD_D == 0) {
+            return;
+          }
+          pos++;
+          continue;
+        } else {
+          // = wasn't the header closing, but part of the header
+          HEAD_D = HEAD_D_ORIG;
+          s = IN_H_TIT;
+          pos++;
+          continue;
+        }
+
+      case IN_CURL:
+        if (text[pos] == '}' && text[pos + 1] == '}') {
+          pos += 2;
+          // nested templates are parsed with the content
+          if (--CRL_D) {
+            opens.pop_back();
+            buffer("}}", 2);
+            continue;
+          }
+          // signal: abort!
+          if (!overlong && !parseCrl(tmp.c_str(), &ret)) {
+            ret.clear();
+            return;
+          }
+          s = TEXT;
+          continue;
+        } else if (text[pos] == '{' && text[pos + 1] == '{') {
+          opens.push_back(pos);
+          buffer("{{", 2);
+          CRL_D++;
+          pos += 2;
+          continue;
+        }
+        break;
+
+      case IN_SSQ:
+        if (text[pos] == ']') {
+          pos += 1;
+          if (--SSQ_D) {
+            opens.pop_back();
+            buffer("]", 1);
+            continue;
+          }
+          if (!overlong) parseSSq(tmp.c_str(), &ret);
+          s = TEXT;
+          continue;
+        } else if (text[pos] == '[') {
+          opens.push_back(pos);
+          buffer("[", 1);
+          SSQ_D++;
+          pos += 1;
+          continue;
+        }
+        break;
+
+      case IN_SQ:
+        if (text[pos] == ']' && text[pos + 1] == ']') {
+          pos += 2;
+          if (--SQ_D) {
+            opens.pop_back();
+            buffer("]]", 2);
+            continue;
+          }
+          if (!overlong) parseSq(tmp.c_str(), &ret);
+          s = TEXT;
+          continue;
+        } else if (text[pos] == '[' && text[pos + 1] == '[') {
+          opens.push_back(pos);
+          buffer("[[", 2);
+          SQ_D++;
+          pos += 2;
+          continue;
+        }
+        break;
+
+      case IN_BR:
+        if (text[pos] == ')') {
+          pos++;
+          if (--BR_D) {
+            opens.pop_back();
+            buffer(")", 1);
+            continue;
+          }
+          // delete the space before the bracket
+          if (ret.size() && ret.back() == ' ') {
+            // keep the first paragraph before cutting into it
+            if (paras && ret.size() == firstPara && firstParaHead.empty())
+              firstParaHead.assign(ret.data(), ret.size());
+            ret.resize(ret.size() - 1);
+          }
+          if (!overlong) parseBr(tmp.c_str(), woBr, &ret);
+          s = TEXT;
+          continue;
+        } else if (text[pos] == '(') {
+          opens.push_back(pos);
+          buffer("(", 1);
+          BR_D++;
+          pos++;
+          continue;
+        }
+        break;
+
+      case IN_TAG:
+        if (text[pos] == '<' && text[pos + 1] == '/') {
+          // the tag is closed if the characters up to a '>' on the line,
+          // without any '>', are its name. As the name only grows, this is
+          // decided after at most its length.
+          size_t p = pos + 2;
+          size_t matched = 0;
+          while (text[p] && text[p] != '\n') {
+            if (text[p] == '>') {
+              if (matched == tmp.size()) break;
+            } else if (matched == tmp.size() || text[p] != tmp[matched]) {
+              break;
+            } else {
+              matched++;
+            }
+            p++;
+          }
+
+          if ((text[p] == '>' || !text[p]) && matched == tmp.size()) {
+            parseXml(tmp.c_str(), tmp2.c_str(), &ret);
+            tmp.clear();
+            tmp2.clear();
+            // don't step over the terminating 0 of an unclosed tag
+            pos = text[p] ? p + 1 : p;
+            s = TEXT;
+            continue;
+          }
+
+          // not closed on this line: continue after its last '>', as text
+          // after the line break
+          if (line.end <= pos) line = lineInfo(text, pos);
+          if (!text[line.end]) {
+            pos = line.end;
+          } else {
+            if (line.lastGt > pos) pos = line.lastGt;
+            s = TEXT;
+            tmp.clear();
+            tmp2.clear();
+          }
+          continue;
+        } else {
+          tmp2 += text[pos];
+          pos++;
+          continue;
+        }
+
+      case TEXT:
+        if (text[pos] == '\n') {
+          // avoid double spaces
+          if (ret.empty() || ret.back() != ' ') ret += ' ';
+          pos++;
+          s = LBEG;
+          continue;
+        } else if (strncmp(text + pos, "__TOC__", 7) == 0) {
+          return;
+        } else if (strncmp(text + pos, "__FORCETOC__", 12) == 0) {
+          return;
+        } else if (strncmp(text + pos, "__NOTOC__", 9) == 0) {
+          pos += 9;
+          continue;
+        } else if (text[pos] == '\'') {
+          pos++;
+          continue;
+        } else if (text[pos] == '<' && text[pos + 1] == '!' &&
+                   text[pos + 2] == '-' && text[pos + 3] == '-') {
+          // comment
+          size_t p = pos + 3;
+          while (true) {
+            p++;
+            if (!text[p]) {
+              pos = p;
+              break;
+            } else if (text[p] == '-' && text[p + 1] == '-' &&
+                       text[p + 2] == '>') {
+              pos = p + 3;
+              break;
+            }
+          }
+          s = TEXT;
+          continue;
+        } else if (text[pos] == '<') {
+          // without a '>', no tag starts on the rest of the line
+          if (line.end <= pos) line = lineInfo(text, pos);
+          if (text[line.end] && line.lastGt < pos) {
+            pos++;
+            continue;
+          }
+
+          s = IN_TAG;
+          tmp.clear();
+          tmp2.clear();
+          size_t p = pos;
+          while (text[p]) {
+            p++;
+            if (text[p] == '\n') {
+              s = TEXT;
+              tmp.clear();
+              tmp2.clear();
+              break;
+            } else if (text[p] == '>') {
+              pos = p;
+              size_t sp = tmp.find(' ');
+              if (sp != ArenaString::npos) tmp.resize(sp);
+              break;
+            } else if (text[p] == '/' && text[p + 1] == '>') {
+              pos = p + 1;
+              tmp.clear();
+              tmp2.clear();
+              s = TEXT;
+              break;
+            } else {
+              tmp += text[p];
+            }
+          }
+
+          pos++;
+          continue;
+        } else {
+          if (text[pos] == '{' && text[pos + 1] == '{') {
+            if (plain(IN_CURL)) {
+              pos = skipUnclosedTemplate(text, pos + 2);
+              continue;
+            }
+            open = pos;
+            // most templates only produce output in parseCrl() if they have
+            // a handler, skip the others without buffering their body
+            if (!rendered(text + pos + 2)) {
+              pos += 2;
+              if (!skipTemplate(text, &pos, &opens)) {
+                s = IN_CURL;
+                unclosed();
+              }
+              continue;
+            }
+            s = IN_CURL;
+            CRL_D = 1;
+            tmp.clear();
+            overlong = false;
+            opens.clear();
+            pos += 2;
+            continue;
+          } else if (text[pos] == '{' && text[pos + 1] == '|') {
+            // tables are dropped
+            pos = skipTable(text, pos + 2);
+            continue;
+          } else if (text[pos] == '[' && text[pos + 1] == '[') {
+            if (plain(IN_SQ)) {
+              pos += 2;
+              continue;
+            }
+            s = IN_SQ;
+            SQ_D = 1;
+            tmp.clear();
+            overlong = false;
+            open = pos;
+            opens.clear();
+            pos += 2;
+            continue;
+          } else if (text[pos] == '[') {
+            if (plain(IN_SSQ)) {
+              pos++;
+              continue;
+            }
+            s = IN_SSQ;
+            SSQ_D = 1;
+            tmp.clear();
+            overlong = false;
+            open = pos;
+            opens.clear();
+            pos += 1;
+            continue;
+          } else if (text[pos] == '(') {
+            if (plain(IN_BR)) {
+              pos++;
+              continue;
+            }
+            s = IN_BR;
+            BR_D = 1;
+            tmp.clear();
+            overlong = false;
+            open = pos;
+            opens.clear();
+            pos += 1;
+            continue;
+          }
+        }
+
+        if (text[pos] != ' ' || ret.empty() || ret.back() != ' ') {
+          ret += text[pos];
+        }
+        pos++;
+
+        // copy the following plain text at once
+        {
+          size_t run = plainRun(text + pos, text[pos - 1] == ' ');
+          ret.append(text + pos, run);
+          pos += run;
+        }
+        continue;
+    }
+
+    // the content of a link, bracket or template
+    buffer(text + pos, 1);
+    pos++;
+  }
+
+  if (paras > 1) {
+    if (firstParaHead.size())
+      ret.assign(firstParaHead.data(), firstParaHead.size());
+    else
+      ret.resize(firstPara);
+  }
+}
+
+// the decoder states, see EntityDecoder::put()
+enum DecodeStage {
+  D_TEXT,
+  D_AMP,
+  D_NAMED,
+  D_HASH,
+  D_NUM,
+  D_NUM_WS,
+  D_NUM_SIGN,
+  D_ZERO16,
+  D_X16,
+  D_DIGITS
+};
+
+// _____________________________________________________________________________
+static size_t digitValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+  return 36;
+}
+
+// appends to a string, a 0 byte ends the string
+class StringSink {
+ public:
+  explicit StringSink(ArenaString* str) : _str(str), _done(false) {}
+
+  void put(char c) {
+    if (_done) return;
+    if (!c) {
+      _done = true;
+      return;
+    }
+    *_str += c;
+  }
+
+  void finish() {}
+
+ private:
+  ArenaString* _str;
+  bool _done;
+};
+
+// Streaming version of pfxml::file::decode(), the characters are decoded
+// as they are put and passed on to next. The output is exactly the one of
+// decode() on the concatenated input, including its quirks: numeric
+// entities are parsed with strtoul() semantics, and a decoded &#0; ends the
+// string.
+template <typename Next>
+class EntityDecoder {
+ public:
+  explicit EntityDecoder(Next* next)
+      : _next(next),
+        _s(D_TEXT),
+        _done(false),
+        _base(10),
+        _neg(false),
+        _val(0),
+        _ovf(false) {}
+
+  // ___________________________________________________________________________
+  void put(char c) {
+    if (_done) return;
+
+    if (_s == D_TEXT) {
+      if (c == '&') {
+        _pend.assign(1, '&');
+        _s = D_AMP;
+        return;
+      }
+      emit(c);
+      return;
+    }
+
+    _pend += c;
+
+    switch (_s) {
+      case D_AMP:
+        if (c == '#') {
+          _s = D_HASH;
+          return;
+        }
+        _s = D_NAMED;
+        // fall through
+
+      case D_NAMED:
+        if (c == ';') {
+          const char* u =
+              pfxml::file::entity(_pend.data() + 1, _pend.size() - 2);
+          if (!u) return fail();
+          _s = D_TEXT;
+          for (; *u; u++) emit(*u);
+          return;
+        }
+        // entity names are alphanumeric
+        if (!pfxml::is_alnum(c) || _pend.size() - 1 > pfxml::MAX_ENTITY_S) {
+          fail();
+        }
+        return;
+
+      case D_HASH:
+        if (c == 'x' || c == 'X') {
+          _base = 16;
+          _s = D_NUM;
+          return;
+        }
+        _base = 10;
+        _s = D_NUM;
+        // fall through
+
+      case D_NUM:
+        // strtoul() without any digits points to the start
+        if (c == ';') return match(0);
+        _neg = false;
+        _val = 0;
+        _ovf = false;
+        _s = D_NUM_WS;
+        // fall through
+
+      case D_NUM_WS:
+        if (c == ' ' || (c >= '\t' && c <= '\r')) return;
+        if (c == '+' || c == '-') {
+          _neg = c == '-';
+          _s = D_NUM_SIGN;
+          return;
+        }
+        // fall through
+
+      case D_NUM_SIGN:
+        if (_base == 16 && c == '0') {
+          _s = D_ZERO16;
+          return;
+        }
+        if (digitValue(c) < _base) {
+          _s = D_DIGITS;
+          digit(c);
+          return;
+        }
+        return fail();
+
+      case D_ZERO16:
+        // possible 0x prefix
+        if (c == 'x' || c == 'X') {
+          _s = D_X16;
+          return;
+        }
+        _s = D_DIGITS;
+        // fall through
+
+      case D_DIGITS:
+        if (digitValue(c) < _base) {
+          digit(c);
+          return;
+        }
+        if (c == ';' && !_ovf && (!_neg || !_val)) return match(_val);
+        return fail();
+
+      case D_X16:
+        // without following digits, strtoul() stops at the x
+        if (digitValue(c) < 16) {
+          _s = D_DIGITS;
+          digit(c);
+          return;
+        }
+        return fail();
+
+      case D_TEXT:
+        return;
+    }
+  }
+
+  // ___________________________________________________________________________
+  void finish() {
+    while (_s != D_TEXT && !_done) fail();
+    if (!_done) _next->finish();
+    _done = true;
+  }
+
+ private:
+  Next* _next;
+  DecodeStage _s;
+  bool _done;
+
+  // the characters of a possible entity, starting with '&'
+  ArenaString _pend;
+  ArenaString _refeed;
+
+  size_t _base;
+  bool _neg;
+  size_t _val;
+  bool _ovf;
+
+  // ___________________________________________________________________________
+  void emit(char c) {
+    if (c) return _next->put(c);
+    // 0 byte, the decoded string ends here
+    _next->finish();
+    _done = true;
+  }
+
+  // ___________________________________________________________________________
+  void digit(char c) {
+    if (_ovf) return;
+    _val = _val * _base + digitValue(c);
+    if (_val > 0x1FFFFF) _ovf = true;
+  }
+
+  // ___________________________________________________________________________
+  void match(size_t cp) {
+    _s = D_TEXT;
+    char buf[4];
+    size_t n = utf8(cp, buf);
+    for (size_t i = 0; i < n && !_done; i++) emit(buf[i]);
+  }
+
+  // ___________________________________________________________________________
+  void fail() {
+    // no entity, output the '&' as is and continue after it. Only the last
+    // pending character can be a '&', so the re-fed characters start at
+    // most one new entity, after the loop.
+    _s = D_TEXT;
+    _refeed.swap(_pend);
+    emit('&');
+    for (size_t i = 1; i < _refeed.size(); i++) put(_refeed[i]);
+  }
+
+  // ___________________________________________________________________________
+  static size_t utf8(size_t cp, char* out) {
+    if (cp <= 0x7F) {
+      out[0] = cp & 0x7F;
+      return 1;
+    } else if (cp <= 0x7FF) {
+      out[0] = 0xC0 | (cp >> 6);
+      out[1] = 0x80 | (cp & 0x3F);
+      return 2;
+    } else if (cp <= 0xFFFF) {
+      out[0] = 0xE0 | (cp >> 12);
+      out[1] = 0x80 | ((cp >> 6) & 0x3F);
+      out[2] = 0x80 | (cp & 0x3F);
+      return 3;
+    }
+    out[0] = 0xF0 | (cp >> 18);
+    out[1] = 0x80 | ((cp >> 12) & 0x3F);
+    out[2] = 0x80 | ((cp >> 6) & 0x3F);
+    out[3] = 0x80 | (cp & 0x3F);
+    return 4;
+  }
+};
+
+// _____________________________________________________________________________
+bool abstract(const char* text, std::string* ret) {
+  return abstract(text, ret, 0);
+}
+
+// _____________________________________________________________________________
+bool abstract(const char* text, std::string* ret, AbstractTimes* times) {
+  // the scope keeps the arena of the page until the abstract is written
+  ScratchScope sc;
+  ArenaString& raw = sc->tmp;
+  ArenaString& dec = sc->tmp2;
+
+  std::chrono::steady_clock::time_point t;
+  if (times) t = std::chrono::steady_clock::now();
+  dropped = false;
+
+  parse(text, 10, true, &raw);
+  if (times) times->parseNs += nsSince(&t);
+
+  // decode two times in a single scan, because the decoded text may be
+  // XML again (&amp;lt; -> &lt; -> <)
+  dec.clear();
+  StringSink sink(&dec);
+  EntityDecoder<StringSink> second(&sink);
+  EntityDecoder<EntityDecoder<StringSink>> first(&second);
+  for (char c : raw) first.put(c);
+  first.finish();
+  if (times) times->decodeNs += nsSince(&t);
+
+  parse(dec.c_str(), 10, false, ret);
+  if (times) times->parseNs += nsSince(&t);
+
+  return !(dropped && ret->empty());
+}
+
+// _____________________________________________________________________________
+void collectScratchStats() { collectStats = true; }
+
+// _____________________________________________________________________________
+ScratchStats scratchStats() {
+  ScratchStats ret;
+  ret.pages = statPages;
+  ret.sumPageBytes = statSumPageBytes;
+  ret.maxPageBytes = statMaxPageBytes;
+  ret.maxArenaBytes = statMaxArenaBytes;
+  return ret;
+}
+
+template void parseSSq(const char* str, std::string* out);
+template void parseSq(const char* str, std::string* out);
+template bool parseCrl(const char* str, std::string* out);
+template void parseXml(const char* tag, const char* content, std::string* out);
+template void parseBr(const char* str, bool woBr, std::string* out);
+template void parse(const char* text, size_t maxParas, bool woBr,
+                    std::string* out);
+template void parse(const char* text, size_t maxParas, bool woBr,
+                    ArenaString* out);
@@ -0,0 +1,72 @@
+// Copyright 2019, University of Freiburg,
+// Chair of Algorithms and Data Structures.
+// Authors: Patrick Brosi <brosi@informatik.uni-freiburg.de>
+
+#ifndef WIKITEXT_H_
+#define WIKITEXT_H_
+
+#include <cstdint>
+#include <string>
+#include "Arena.h"
+
+// parse() calls nested deeper than this, through links, brackets and
+// template arguments, output nothing. Each nesting level parses the content
+// of its constructs again, so this bounds how often a byte is parsed.
+static const size_t MAX_PARSE_DEPTH = 8;
+
+// a link, bracket or rendered template whose content is longer than this is
+// skipped up to its closing bracket and dropped, which bounds the scratch
+// memory of parse() and the text parsed again by the handlers
+static const size_t MAX_CONSTRUCT_S = 16 * 1024;
+
+// the handlers append the clear text of a wikitext construct to out. All
+// scratch memory of a call comes from the arena of the thread and is released
+// when the outermost call returns, so Str is std::string, or ArenaString only
+// for calls made by the parser itself.
+template <typename Str>
+void parseSSq(const char* str, Str* out);
+template <typename Str>
+void parseSq(const char* str, Str* out);
+// returns false if the page should be dropped
+template <typename Str>
+bool parseCrl(const char* str, Str* out);
+template <typename Str>
+void parseXml(const char* tag, const char* content, Str* out);
+template <typename Str>
+void parseBr(const char* str, bool woBr, Str* out);
+
+std::string parse(const char* text, size_t maxParas, bool woBr);
+template <typename Str>
+void parse(const char* text, size_t maxParas, bool woBr, Str* ret);
+
+// time spent in the passes of abstract(), in nanoseconds
+struct AbstractTimes {
+  AbstractTimes() : parseNs(0), decodeNs(0) {}
+  uint64_t parseNs;
+  uint64_t decodeNs;
+};
+
+// write the abstract of the (still XML-escaped) wikitext of an article to
+// ret. Equivalent to parsing the text, decoding it two times (the decoded
+// text may be XML again), and parsing it again, but without intermediate
+// strings. Returns false if the abstract is empty because a template
+// dropped the page, as disambiguation pages are.
+bool abstract(const char* text, std::string* ret);
+
+// the same, the time spent in the passes is added to times
+bool abstract(const char* text, std::string* ret, AbstractTimes* times);
+
+// scratch memory used by the outermost parser calls, one per page
+struct ScratchStats {
+  size_t pages;
+  size_t sumPageBytes;
+  size_t maxPageBytes;
+  // the largest arena of a thread
+  size_t maxArenaBytes;
+};
+
+// collect ScratchStats from now on, must be called before parsing starts
+void collectScratchStats();
+ScratchStats scratchStats();
+
+#endif  // WIKITEXT_H_
@@ -4,15 +4,23 @@
 #ifndef PFXML_H_
 #define PFXML_H_
 
+#include <bzlib.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
+#include <exception>
 #include <fstream>
 #include <map>
+#include <mutex>
 #include <sstream>
-#include <stack>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace pfxml {
@@ -22,6 +30,18 @@ namespace pfxml {
 
 static const size_t BUFFER_S = 32 * 1024 * 1024;
 
+// size of the compressed input buffer for bzip2 files
+static const size_t BZ2_BUFFER_S = 1024 * 1024;
+
+// in mmap mode, the kernel is asked to prefetch this much ahead of the
+// parser, and the private copies of pages behind the parser are dropped in
+// steps of this size
+static const size_t MMAP_WINDOW_S = 64 * 1024 * 1024;
+
+// read-ahead ring of the async source
+static const size_t ASYNC_SLOT_S = 8 * 1024 * 1024;
+static const size_t ASYNC_SLOTS = 4;
+
 enum state {
   NONE,
   IN_TAG_NAME,
@@ -558,6 +578,78 @@ static const std::map<std::string, const char*> ENTITIES = {
 
 };
 
+// decode() matches entity names up to the first ';', so only the names
+// without ';' can be found. They are at most this long.
+static const size_t MAX_ENTITY_S = 8;
+
+// character classes, a character may have several
+static const uint8_t CC_SPACE = 1;  // std::isspace() in the "C" locale
+static const uint8_t CC_ALNUM = 2;  // ASCII letter or digit
+static const uint8_t CC_NAME = 4;   // alnum, -, _ or ., may be in tag names
+
+// _____________________________________________________________________________
+constexpr uint8_t char_class(unsigned char c) {
+  return ((c == ' ' || (c >= '\t' && c <= '\r')) ? CC_SPACE : 0) |
+         (((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9'))
+              ? CC_ALNUM | CC_NAME
+              : 0) |
+         ((c == '-' || c == '_' || c == '.') ? CC_NAME : 0);
+}
+
+// the classes of all 256 characters, computed at compile time. Unlike
+// std::isspace() and friends, the lookup does not depend on the locale and
+// is defined for negative chars, i.e. UTF-8 bytes >= 0x80.
+template <size_t N, size_t... I>
+struct char_class_table : char_class_table<N - 1, N - 1, I...> {};
+
+template <size_t... I>
+struct char_class_table<0, I...> {
+  static constexpr uint8_t classes[sizeof...(I)] = {char_class(I)...};
+};
+
+template <size_t... I>
+constexpr uint8_t char_class_table<0, I...>::classes[sizeof...(I)];
+
+typedef char_class_table<256> char_classes;
+
+// _____________________________________________________________________________
+inline bool is_space(char c) {
+  return char_classes::classes[static_cast<unsigned char>(c)] & CC_SPACE;
+}
+
+// _____________________________________________________________________________
+inline bool is_alnum(char c) {
+  return char_classes::classes[static_cast<unsigned char>(c)] & CC_ALNUM;
+}
+
+// _____________________________________________________________________________
+inline bool is_name_char(char c) {
+  return char_classes::classes[static_cast<unsigned char>(c)] & CC_NAME;
+}
+
+// perfect hash table over the entity names in ENTITIES which decode() can
+// match. A name is packed into a 64 bit integer, which is hashed by a
+// multiplication with a constant chosen such that no two names collide.
+class entity_table {
+ public:
+  entity_table();
+
+  // the UTF-8 string for the entity name of length len, 0 if there is none
+  const char* get(const char* name, size_t len) const;
+
+ private:
+  static const size_t BITS = 12;
+  uint64_t _mul;
+  // index + 1 into _keys and _vals, 0 for empty slots
+  uint16_t _slots[1 << BITS];
+  std::vector<uint64_t> _keys;
+  std::vector<const char*> _vals;
+
+  static uint64_t pack(const char* name, size_t len);
+  size_t slot(uint64_t key) const { return (key * _mul) >> (64 - BITS); }
+};
+
 class parse_exc : public std::exception {
  public:
   parse_exc(std::string msg, std::string file, const char* p, char* buff,
@@ -574,9 +666,192 @@ class parse_exc : public std::exception {
   std::string _msg;
 };
 
+// source of the raw (uncompressed) XML bytes
+class source {
+ public:
+  virtual ~source() {}
+
+  // read at most n bytes into buf, returns 0 at the end of the input
+  virtual size_t read(char* buf, size_t n) = 0;
+
+  // continue reading at uncompressed byte offset off
+  virtual void seek(int64_t off) = 0;
+};
+
+// plain XML file
+class fd_source : public source {
+ public:
+  fd_source(const std::string& path);
+  ~fd_source();
+
+  size_t read(char* buf, size_t n);
+  void seek(int64_t off);
+
+ private:
+  int _file;
+};
+
+// bzip2 compressed XML file, may consist of multiple concatenated streams
+class bz2_source : public source {
+ public:
+  bz2_source(const std::string& path);
+  ~bz2_source();
+
+  size_t read(char* buf, size_t n);
+  void seek(int64_t off);
+
+ private:
+  int _file;
+  std::string _path;
+  bz_stream _strm;
+  char* _in;
+  bool _eof;
+  bool _in_stream;
+};
+
+// bzip2 multistream XML file, the streams listed in the index file are
+// decompressed in parallel and handed out in file order
+class bz2_multistream_source : public source {
+ public:
+  bz2_multistream_source(const std::string& path, const std::string& index,
+                         size_t threads);
+  ~bz2_multistream_source();
+
+  size_t read(char* buf, size_t n);
+  void seek(int64_t off);
+
+ private:
+  int _file;
+  std::string _path;
+
+  // compressed stream boundaries, including 0 and the file size
+  std::vector<int64_t> _offs;
+
+  std::vector<std::thread> _workers;
+  std::mutex _m;
+  std::condition_variable _res_cv;
+  std::condition_variable _task_cv;
+
+  // decompressed streams which have not been consumed yet
+  std::map<size_t, std::string> _done;
+  size_t _next_task;
+  size_t _cur;
+  size_t _window;
+  bool _stop;
+
+  // the error of the first stream which could not be decompressed, it is
+  // rethrown after the streams before it were read
+  std::exception_ptr _err;
+  size_t _err_stream;
+
+  std::string _chunk;
+  size_t _chunk_pos;
+
+  void work();
+  void decompress(size_t i, std::string* out) const;
+};
+
+// reads ahead of the parser from another source in a background thread
+class async_source : public source {
+ public:
+  // takes ownership of src
+  async_source(source* src);
+  ~async_source();
+
+  size_t read(char* buf, size_t n);
+  void seek(int64_t off);
+
+ private:
+  source* _src;
+
+  std::vector<char*> _slots;
+  std::vector<size_t> _lens;
+  size_t _head;
+  size_t _tail;
+  size_t _filled;
+  size_t _pos;
+
+  bool _eof;
+  bool _stop;
+  std::exception_ptr _err;
+
+  std::mutex _m;
+  std::condition_variable _cv;
+  std::thread _thread;
+
+  void start();
+  void halt();
+  void work();
+};
+
+struct io_stats {
+  io_stats() : bytes(0), reads(0), wait_ns(0) {}
+  // uncompressed bytes read from the input
+  int64_t bytes;
+  // number of buffer refills
+  size_t reads;
+  // time spent waiting for input data
+  int64_t wait_ns;
+};
+
+// maximum nesting depth of tags
+static const size_t MAX_TAG_DEPTH = 256;
+
+// id of the virtual root tag, which is always at the bottom of the stack
+static const uint32_t ROOT_TAG = 0;
+
+// tag names interned into small integer ids, per file
+class tag_names {
+ public:
+  tag_names();
+
+  // the id of name, which gets a new one if it is unknown
+  uint32_t id(const char* name);
+
+  // only valid until the next new name
+  const char* name(uint32_t id) const;
+
+ private:
+  std::vector<std::string> _names;
+  // open addressing, id + 1 or 0 for empty slots, at most half full
+  std::vector<uint32_t> _slots;
+
+  static size_t hash(const char* name);
+};
+
+// stack of tag ids with a fixed capacity, copying it does not allocate
+class id_stack {
+ public:
+  id_stack() : _size(0) {}
+  id_stack(const id_stack& other) : _size(other._size) {
+    memcpy(_ids, other._ids, _size * sizeof(uint32_t));
+  }
+  id_stack& operator=(const id_stack& other) {
+    _size = other._size;
+    memcpy(_ids, other._ids, _size * sizeof(uint32_t));
+    return *this;
+  }
+
+  // false if the stack is full
+  bool push(uint32_t id) {
+    if (_size == MAX_TAG_DEPTH) return false;
+    _ids[_size++] = id;
+    return true;
+  }
+  void pop() { _size--; }
+  uint32_t top() const { return _ids[_size - 1]; }
+  size_t size() const { return _size; }
+  bool empty() const { return !_size; }
+
+ private:
+  uint32_t _ids[MAX_TAG_DEPTH];
+  size_t _size;
+};
+
 struct parser_state {
   parser_state() : s(NONE), hanging(0), off(0) {}
-  std::stack<std::string> tag_stack;
+  // ids of the open tags, only meaningful for the file they are from
+  id_stack tag_stack;
   state s;
   size_t hanging;
   int64_t off;
@@ -596,9 +871,30 @@ struct tag {
   }
 };
 
+struct file_opts {
+  file_opts() : threads(0), mmap(false), readahead(true) {}
+
+  // multistream index file, if empty, the index is searched next to the
+  // dump (foo-multistream.xml.bz2 -> foo-multistream-index.txt.bz2)
+  std::string index;
+
+  // number of decompression threads for multistream files, 0 means one
+  // thread per core
+  size_t threads;
+
+  // parse uncompressed files directly from a private (copy-on-write)
+  // memory mapping instead of reading them into buffers
+  bool mmap;
+
+  // read the next buffer in a background thread while the current one is
+  // parsed
+  bool readahead;
+};
+
 class file {
  public:
   file(const std::string& path);
+  file(const std::string& path, const file_opts& opts);
   ~file();
 
   const tag& get() const;
@@ -608,11 +904,21 @@ class file {
   void reset();
   parser_state state();
   void set_state(const parser_state& s);
+  bool seek(int64_t off, const char* name);
+  bool skip(const char* name);
+  bool jump(const char* name, const char* stop);
+  int64_t offset() const;
+  int64_t consumed() const;
+  const io_stats& stats() const;
   static std::string decode(const char* str);
   static std::string decode(const std::string& str);
+  static void decode(const char* str, std::string* ret);
+  static const char* entity(const char* name, size_t len);
+  static bool is_bz2(const std::string& path);
 
  private:
-  int _file;
+  source* _src;
+  file_opts _opts;
   parser_state _s;
   parser_state _prevs;
   char** _buf;
@@ -628,33 +934,519 @@ class file {
   int64_t _tot_read_bef;
   int64_t _last_new_data;
 
+  // mmap mode, _buf[0] is the mapping
+  bool _mapped;
+  size_t _map_size;
+  int64_t _advised;
+  int64_t _dropped;
+
+  io_stats _stats;
+
   tag _ret;
 
   static size_t utf8(size_t cp, char* out);
+  static source* open_source(const std::string& path, const file_opts& opts);
+  void map();
+  void unmap();
+  void advise();
+  size_t fill(char* buf, size_t n);
+  void push_tag(const char* name);
+  bool is_top(const char* name) const;
   const char* empty_str = "";
+
+  tag_names _tag_names;
+
+  friend class bz2_multistream_source;
 };
 
 // _____________________________________________________________________________
-inline file::file(const std::string& path)
-    : _file(0),
+inline fd_source::fd_source(const std::string& path) {
+  _file = open(path.c_str(), O_RDONLY);
+  if (_file < 0)
+    throw parse_exc(std::string("could not open file"), path, 0, 0, 0);
+#ifdef __unix__
+  posix_fadvise(_file, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+// _____________________________________________________________________________
+inline fd_source::~fd_source() { close(_file); }
+
+// _____________________________________________________________________________
+inline size_t fd_source::read(char* buf, size_t n) {
+  ssize_t r = ::read(_file, buf, n);
+  return r < 0 ? 0 : r;
+}
+
+// _____________________________________________________________________________
+inline void fd_source::seek(int64_t off) { lseek(_file, off, SEEK_SET); }
+
+// _____________________________________________________________________________
+inline bz2_source::bz2_source(const std::string& path)
+    : _path(path), _eof(false), _in_stream(false) {
+  _file = open(path.c_str(), O_RDONLY);
+  if (_file < 0)
+    throw parse_exc(std::string("could not open file"), path, 0, 0, 0);
+#ifdef __unix__
+  posix_fadvise(_file, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  _in = new char[BZ2_BUFFER_S];
+  memset(&_strm, 0, sizeof(_strm));
+}
+
+// _____________________________________________________________________________
+inline bz2_source::~bz2_source() {
+  if (_in_stream) BZ2_bzDecompressEnd(&_strm);
+  delete[] _in;
+  close(_file);
+}
+
+// _____________________________________________________________________________
+inline size_t bz2_source::read(char* buf, size_t n) {
+  _strm.next_out = buf;
+  _strm.avail_out = n;
+
+  while (_strm.avail_out) {
+    if (!_strm.avail_in) {
+      ssize_t r = _eof ? 0 : ::read(_file, _in, BZ2_BUFFER_S);
+      if (r <= 0) {
+        _eof = true;
+        // hand out the data decompressed so far before failing
+        if (_in_stream && _strm.avail_out == n)
+          throw parse_exc("Unexpected end of bzip2 stream", _path, 0, 0, 0);
+        break;
+      }
+      _strm.next_in = _in;
+      _strm.avail_in = r;
+    }
+
+    if (!_in_stream) {
+      // dumps may consist of many concatenated streams
+      if (BZ2_bzDecompressInit(&_strm, 0, 0) != BZ_OK)
+        throw parse_exc("Could not initialize bzip2 decoder", _path, 0, 0, 0);
+      _in_stream = true;
+    }
+
+    int ret = BZ2_bzDecompress(&_strm);
+    if (ret == BZ_STREAM_END) {
+      BZ2_bzDecompressEnd(&_strm);
+      _in_stream = false;
+    } else if (ret != BZ_OK) {
+      throw parse_exc("Invalid bzip2 data", _path, 0, 0, 0);
+    }
+  }
+
+  return n - _strm.avail_out;
+}
+
+// _____________________________________________________________________________
+inline void bz2_source::seek(int64_t) {
+  throw parse_exc("Seeking is not supported in bzip2 files", _path, 0, 0, 0);
+}
+
+// _____________________________________________________________________________
+inline bz2_multistream_source::bz2_multistream_source(const std::string& path,
+                                                      const std::string& index,
+                                                      size_t threads)
+    : _path(path),
+      _next_task(0),
+      _cur(0),
+      _stop(false),
+      _err_stream(0),
+      _chunk_pos(0) {
+  _file = open(path.c_str(), O_RDONLY);
+  if (_file < 0)
+    throw parse_exc(std::string("could not open file"), path, 0, 0, 0);
+
+  // index lines have the form <offset>:<page id>:<title>, 100 pages share
+  // the same stream offset
+  source* idx = file::open_source(index, file_opts());
+  char* buf = new char[BZ2_BUFFER_S];
+  int64_t num = 0;
+  bool in_num = true;
+  size_t r;
+  _offs.push_back(0);
+  while ((r = idx->read(buf, BZ2_BUFFER_S))) {
+    for (size_t i = 0; i < r; i++) {
+      if (in_num) {
+        if (buf[i] >= '0' && buf[i] <= '9') {
+          num = num * 10 + (buf[i] - '0');
+          continue;
+        }
+        if (num != _offs.back()) _offs.push_back(num);
+        in_num = false;
+      }
+      if (buf[i] == '\n') {
+        in_num = true;
+        num = 0;
+      }
+    }
+  }
+  delete[] buf;
+  delete idx;
+
+  struct stat st;
+  fstat(_file, &st);
+  std::sort(_offs.begin(), _offs.end());
+  _offs.erase(std::unique(_offs.begin(), _offs.end()), _offs.end());
+  while (_offs.size() && _offs.back() >= st.st_size) _offs.pop_back();
+  _offs.push_back(st.st_size);
+
+  if (!threads) threads = std::thread::hardware_concurrency();
+  if (!threads) threads = 1;
+
+  // limit the number of decompressed streams kept in memory
+  _window = 4 * threads;
+
+  for (size_t i = 0; i < threads; i++) {
+    _workers.push_back(std::thread(&bz2_multistream_source::work, this));
+  }
+}
+
+// _____________________________________________________________________________
+inline bz2_multistream_source::~bz2_multistream_source() {
+  {
+    std::unique_lock<std::mutex> lock(_m);
+    _stop = true;
+  }
+  _task_cv.notify_all();
+  for (auto& w : _workers) w.join();
+  close(_file);
+}
+
+// _____________________________________________________________________________
+inline size_t bz2_multistream_source::read(char* buf, size_t n) {
+  size_t got = 0;
+
+  while (got < n) {
+    if (_chunk_pos == _chunk.size()) {
+      std::unique_lock<std::mutex> lock(_m);
+      if (_cur == _offs.size() - 1) break;
+      // streams before _err_stream were all handed to a worker, which
+      // either finishes them or fails on them first
+      _res_cv.wait(lock, [this] {
+        return _done.count(_cur) || (_err && _cur >= _err_stream);
+      });
+      if (!_done.count(_cur)) {
+        // return what was read before, the next read fails
+        if (got) break;
+        std::rethrow_exception(_err);
+      }
+      _chunk.swap(_done[_cur]);
+      _done.erase(_cur);
+      _chunk_pos = 0;
+      _cur++;
+      lock.unlock();
+      _task_cv.notify_all();
+      continue;
+    }
+
+    size_t c = std::min(n - got, _chunk.size() - _chunk_pos);
+    memcpy(buf + got, _chunk.data() + _chunk_pos, c);
+    _chunk_pos += c;
+    got += c;
+  }
+
+  return got;
+}
+
+// _____________________________________________________________________________
+inline void bz2_multistream_source::seek(int64_t) {
+  throw parse_exc("Seeking is not supported in bzip2 files", _path, 0, 0, 0);
+}
+
+// _____________________________________________________________________________
+inline void bz2_multistream_source::work() {
+  while (true) {
+    size_t t;
+    {
+      std::unique_lock<std::mutex> lock(_m);
+      // after an error, the streams left follow the failed one, no longer
+      // needed
+      _task_cv.wait(lock, [this] {
+        return _stop || _err || _next_task >= _offs.size() - 1 ||
+               _next_task < _cur + _window;
+      });
+      if (_stop || _err || _next_task >= _offs.size() - 1) return;
+      t = _next_task++;
+    }
+
+    std::string out;
+    try {
+      decompress(t, &out);
+    } catch (...) {
+      // also std::bad_alloc, the consumer rethrows it
+      std::unique_lock<std::mutex> lock(_m);
+      if (!_err || t < _err_stream) {
+        _err = std::current_exception();
+        _err_stream = t;
+      }
+      lock.unlock();
+      _res_cv.notify_all();
+      _task_cv.notify_all();
+      return;
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(_m);
+      _done[t].swap(out);
+    }
+    _res_cv.notify_all();
+  }
+}
+
+// _____________________________________________________________________________
+inline void bz2_multistream_source::decompress(size_t i,
+                                               std::string* out) const {
+  size_t size = _offs[i + 1] - _offs[i];
+  std::vector<char> in(size);
+
+  size_t got = 0;
+  while (got < size) {
+    ssize_t r = pread(_file, in.data() + got, size - got, _offs[i] + got);
+    if (r <= 0) throw parse_exc("Could not read bzip2 stream", _path, 0, 0,
+                                _offs[i]);
+    got += r;
+  }
+
+  bz_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  strm.next_in = in.data();
+  strm.avail_in = size;
+
+  out->resize(8 * size);
+  size_t outPos = 0;
+
+  // a chunk may contain more than one stream
+  while (strm.avail_in) {
+    if (BZ2_bzDecompressInit(&strm, 0, 0) != BZ_OK)
+      throw parse_exc("Could not initialize bzip2 decoder", _path, 0, 0,
+                      _offs[i]);
+    int ret = BZ_OK;
+    while (ret == BZ_OK) {
+      if (outPos == out->size()) out->resize(2 * out->size());
+      strm.next_out = &(*out)[outPos];
+      strm.avail_out = out->size() - outPos;
+      ret = BZ2_bzDecompress(&strm);
+      outPos = out->size() - strm.avail_out;
+      if (ret == BZ_OK && !strm.avail_in && strm.avail_out) break;
+    }
+    BZ2_bzDecompressEnd(&strm);
+    if (ret != BZ_STREAM_END)
+      throw parse_exc("Invalid bzip2 stream", _path, 0, 0, _offs[i]);
+  }
+
+  out->resize(outPos);
+}
+
+// _____________________________________________________________________________
+inline async_source::async_source(source* src)
+    : _src(src),
+      _slots(ASYNC_SLOTS),
+      _lens(ASYNC_SLOTS),
+      _head(0),
+      _tail(0),
+      _filled(0),
+      _pos(0),
+      _eof(false),
+      _stop(false) {
+  for (auto& slot : _slots) slot = new char[ASYNC_SLOT_S];
+  start();
+}
+
+// _____________________________________________________________________________
+inline async_source::~async_source() {
+  halt();
+  for (auto slot : _slots) delete[] slot;
+  delete _src;
+}
+
+// _____________________________________________________________________________
+inline size_t async_source::read(char* buf, size_t n) {
+  size_t got = 0;
+
+  while (got < n) {
+    {
+      std::unique_lock<std::mutex> lock(_m);
+      _cv.wait(lock, [this] { return _filled || _eof || _err; });
+      if (!_filled) {
+        if (_err) std::rethrow_exception(_err);
+        break;
+      }
+    }
+
+    // the producer never touches filled slots
+    size_t c = std::min(n - got, _lens[_tail] - _pos);
+    memcpy(buf + got, _slots[_tail] + _pos, c);
+    got += c;
+    _pos += c;
+
+    if (_pos == _lens[_tail]) {
+      {
+        std::unique_lock<std::mutex> lock(_m);
+        _tail = (_tail + 1) % _slots.size();
+        _filled--;
+        _pos = 0;
+      }
+      _cv.notify_all();
+    }
+  }
+
+  return got;
+}
+
+// _____________________________________________________________________________
+inline void async_source::seek(int64_t off) {
+  halt();
+  _head = _tail = _filled = _pos = 0;
+  _eof = _stop = false;
+  _err = std::exception_ptr();
+  try {
+    _src->seek(off);
+  } catch (...) {
+    // no reader thread runs, later reads throw the error again
+    _err = std::current_exception();
+    throw;
+  }
+  start();
+}
+
+// _____________________________________________________________________________
+inline void async_source::start() {
+  _thread = std::thread(&async_source::work, this);
+}
+
+// _____________________________________________________________________________
+inline void async_source::halt() {
+  {
+    std::unique_lock<std::mutex> lock(_m);
+    _stop = true;
+  }
+  _cv.notify_all();
+  // not running after a failed seek
+  if (_thread.joinable()) _thread.join();
+}
+
+// _____________________________________________________________________________
+inline void async_source::work() {
+  while (true) {
+    size_t slot;
+    {
+      std::unique_lock<std::mutex> lock(_m);
+      _cv.wait(lock, [this] { return _stop || _filled < _slots.size(); });
+      if (_stop) return;
+      slot = _head;
+    }
+
+    size_t r = 0;
+    try {
+      r = _src->read(_slots[slot], ASYNC_SLOT_S);
+    } catch (...) {
+      std::unique_lock<std::mutex> lock(_m);
+      _err = std::current_exception();
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(_m);
+      if (r) {
+        _lens[slot] = r;
+        _head = (_head + 1) % _slots.size();
+        _filled++;
+      } else {
+        _eof = true;
+      }
+    }
+    _cv.notify_all();
+    if (!r) return;
+  }
+}
+
+// _____________________________________________________________________________
+inline bool file::is_bz2(const std::string& path) {
+  int f = open(path.c_str(), O_RDONLY);
+  if (f < 0) return false;
+  char magic[3];
+  bool ret = ::read(f, magic, 3) == 3 && memcmp(magic, "BZh", 3) == 0;
+  close(f);
+  return ret;
+}
+
+// _____________________________________________________________________________
+inline source* file::open_source(const std::string& path,
+                                 const file_opts& opts) {
+  if (!is_bz2(path)) {
+    if (opts.readahead) return new async_source(new fd_source(path));
+    return new fd_source(path);
+  }
+
+  std::string index = opts.index;
+  if (index.empty()) {
+    size_t len = strlen(".xml.bz2");
+    if (path.size() > len && path.compare(path.size() - len, len,
+                                          ".xml.bz2") == 0) {
+      index = path.substr(0, path.size() - len) + "-index.txt.bz2";
+      if (access(index.c_str(), R_OK) != 0) index.clear();
+    }
+  }
+
+  // multistream files are decompressed ahead anyway
+  if (index.size()) return new bz2_multistream_source(path, index,
+                                                      opts.threads);
+  if (opts.readahead) return new async_source(new bz2_source(path));
+  return new bz2_source(path);
+}
+
+// _____________________________________________________________________________
+inline size_t file::fill(char* buf, size_t n) {
+  auto t = std::chrono::steady_clock::now();
+  size_t r = _src->read(buf, n);
+  _stats.wait_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - t)
+                        .count();
+  _stats.bytes += r;
+  _stats.reads++;
+  return r;
+}
+
+// _____________________________________________________________________________
+inline const io_stats& file::stats() const { return _stats; }
+
+// _____________________________________________________________________________
+inline file::file(const std::string& path) : file(path, file_opts()) {}
+
+// _____________________________________________________________________________
+inline file::file(const std::string& path, const file_opts& opts)
+    : _src(0),
+      _opts(opts),
       _c(0),
       _last_bytes(0),
       _which(0),
       _path(path),
-      _tot_read_bef(0) {
+      _tot_read_bef(0),
+      _mapped(opts.mmap && !is_bz2(path)),
+      _map_size(0) {
   _buf = new char*[2];
-  _buf[0] = new char[BUFFER_S + 1];
-  _buf[1] = new char[BUFFER_S + 1];
+  if (_mapped) {
+    _buf[0] = 0;
+    _buf[1] = 0;
+  } else {
+    _buf[0] = new char[BUFFER_S + 1];
+    _buf[1] = new char[BUFFER_S + 1];
+  }
 
   reset();
 }
 
 // _____________________________________________________________________________
 inline file::~file() {
-  delete[] _buf[0];
-  delete[] _buf[1];
+  if (_mapped) {
+    unmap();
+  } else {
+    delete[] _buf[0];
+    delete[] _buf[1];
+  }
   delete[] _buf;
-  close(_file);
+  delete _src;
 }
 
 // _____________________________________________________________________________
@@ -664,22 +1456,37 @@ inline void file::reset() {
   _s.hanging = 0;
   _tot_read_bef = 0;
 
-  if (_file) close(_file);
-  _file = open(_path.c_str(), O_RDONLY);
-  if (_file < 0)
-    throw parse_exc(std::string("could not open file"), _path, 0, 0, 0);
-#ifdef __unix__
-  posix_fadvise(_file, 0, 0, POSIX_FADV_SEQUENTIAL);
-#endif
+  if (_mapped) {
+    map();
+  } else {
+    delete _src;
+    _src = 0;
+    _src = open_source(_path, _opts);
+    _last_bytes = fill(_buf[_which], BUFFER_S);
+  }
 
-  _last_bytes = read(_file, _buf[_which], BUFFER_S);
   _last_new_data = _last_bytes;
   _c = _buf[_which];
+  _ret.name = 0;
+  _ret.text = empty_str;
   while (!_s.tag_stack.empty()) _s.tag_stack.pop();
-  _s.tag_stack.push("[root]");
+  _s.tag_stack.push(ROOT_TAG);
   _prevs = _s;
 }
 
+// _____________________________________________________________________________
+inline void file::push_tag(const char* name) {
+  if (!_s.tag_stack.push(_tag_names.id(name))) {
+    throw parse_exc("Tags nested too deeply", _path, _c, _buf[_which],
+                    _prevs.off);
+  }
+}
+
+// _____________________________________________________________________________
+inline bool file::is_top(const char* name) const {
+  return strcmp(_tag_names.name(_s.tag_stack.top()), name) == 0;
+}
+
 // _____________________________________________________________________________
 inline size_t file::level() const { return _s.tag_stack.size() - _s.hanging; }
 
@@ -691,15 +1498,292 @@ inline void file::set_state(const parser_state& s) {
   _s = s;
   _prevs = s;
 
-  lseek(_file, _s.off, SEEK_SET);
+  if (_mapped) {
+    // the mapping holds the original file content again at the new offset
+    unmap();
+    map();
+    _c = _buf[_which] + std::min<int64_t>(_s.off, _map_size);
+    _dropped = _advised = (_c - _buf[_which]) & ~(MMAP_WINDOW_S - 1);
+    next();
+    return;
+  }
+
+  _src->seek(_s.off);
   _tot_read_bef = _s.off;
-  _last_bytes = read(_file, _buf[_which], BUFFER_S);
+  _last_bytes = fill(_buf[_which], BUFFER_S);
   _last_new_data = _last_bytes;
   _c = _buf[_which];
 
   next();
 }
 
+// _____________________________________________________________________________
+inline void file::map() {
+  _which = 0;
+  _map_size = 0;
+  _buf[0] = 0;
+
+  int f = open(_path.c_str(), O_RDONLY);
+  if (f < 0) {
+    throw parse_exc(std::string("could not open file"), _path, 0, 0, 0);
+  }
+
+  struct stat st;
+  fstat(f, &st);
+  _map_size = st.st_size;
+
+  if (_map_size) {
+    // private mapping, because the parser writes 0 bytes into the buffer
+    void* m = mmap(0, _map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, f, 0);
+    if (m == MAP_FAILED) {
+      close(f);
+      throw parse_exc(std::string("could not map file"), _path, 0, 0, 0);
+    }
+    _buf[0] = static_cast<char*>(m);
+    madvise(_buf[0], _map_size, MADV_SEQUENTIAL);
+  }
+  close(f);
+
+  _last_bytes = _map_size;
+  _last_new_data = _map_size;
+  _stats.bytes = _map_size;
+  _c = _buf[0];
+  _advised = 0;
+  _dropped = 0;
+}
+
+// _____________________________________________________________________________
+inline void file::unmap() {
+  if (_buf[0]) munmap(_buf[0], _map_size);
+  _buf[0] = 0;
+}
+
+// _____________________________________________________________________________
+inline void file::advise() {
+  // prefetch the next window, and drop the private copies of the pages
+  // written to behind the current position. Tokens returned before this
+  // call of next() are not valid anymore anyway.
+
+  int64_t pos = _c - _buf[0];
+
+  if (pos + static_cast<int64_t>(MMAP_WINDOW_S) > _advised &&
+      _advised < static_cast<int64_t>(_map_size)) {
+    size_t len = std::min<size_t>(2 * MMAP_WINDOW_S, _map_size - _advised);
+    madvise(_buf[0] + _advised, len, MADV_WILLNEED);
+    _advised += len;
+  }
+
+  // keep one page before the current position
+  int64_t drop = ((pos - 4096) & ~(MMAP_WINDOW_S - 1)) - _dropped;
+  if (drop > 0) {
+    madvise(_buf[0] + _dropped, drop, MADV_DONTNEED);
+    _dropped += drop;
+  }
+}
+
+// _____________________________________________________________________________
+inline bool file::seek(int64_t off, const char* name) {
+  // cold start at the first <name> tag at or after byte offset off, which
+  // is taken to be a child of the currently open element. Afterwards, the
+  // found tag is the current tag. Returns false if there is no such tag.
+
+  std::string needle = std::string("<") + name;
+
+  if (_mapped) {
+    const char* p = _buf[0] + std::min<int64_t>(off, _map_size);
+    const char* end = _buf[0] + _map_size;
+    while ((p = static_cast<const char*>(
+                memmem(p, end - p, needle.c_str(), needle.size())))) {
+      if (p + needle.size() < end) {
+        char c = p[needle.size()];
+        if (c == '>' || c == '/' || is_space(c)) {
+          parser_state s;
+          s.tag_stack = _s.tag_stack;
+          s.off = p - _buf[0];
+          set_state(s);
+          return true;
+        }
+      }
+      p++;
+    }
+    return false;
+  }
+
+  char* buf = _buf[!_which];
+  size_t keep = 0;
+  int64_t pos = off;
+
+  _src->seek(off);
+  while (true) {
+    size_t readb = _src->read(buf + keep, BUFFER_S - keep);
+    if (!readb) return false;
+    size_t len = keep + readb;
+
+    const char* p = buf;
+    while ((p = static_cast<const char*>(
+                memmem(p, len - (p - buf), needle.c_str(), needle.size())))) {
+      size_t after = p - buf + needle.size();
+      if (after == len) break;
+      char c = buf[after];
+      if (c == '>' || c == '/' || is_space(c)) {
+        parser_state s;
+        s.tag_stack = _s.tag_stack;
+        s.off = pos + (p - buf);
+        set_state(s);
+        return true;
+      }
+      p++;
+    }
+
+    // keep a possibly incomplete match
+    keep = std::min(needle.size(), len);
+    memmove(buf, buf + len - keep, keep);
+    pos += len - keep;
+  }
+}
+
+// _____________________________________________________________________________
+inline bool file::skip(const char* name) {
+  // skip everything up to and including the closing tag of the innermost
+  // open element called name, without tokenizing it. The closing tag is
+  // searched for as "</name>", so elements called name must not be nested
+  // inside it. Afterwards, the next call of next() returns whatever follows
+  // the closing tag. Returns false if there is no such tag.
+
+  std::string needle = std::string("</") + name + ">";
+  const char* end = _buf[_which] + _last_bytes;
+
+  if (_s.s == IN_TAG_TENTATIVE &&
+      end - _c >= static_cast<int64_t>(needle.size()) &&
+      memcmp(_c, needle.c_str() + 1, needle.size() - 1) == 0) {
+    // the '<' of a tag directly following text was already consumed
+    _c += needle.size() - 1;
+  } else {
+    while (true) {
+      const char* p = static_cast<const char*>(
+          memmem(_c, end - _c, needle.c_str(), needle.size()));
+      if (p) {
+        _c += (p - _c) + needle.size();
+        break;
+      }
+
+      _c = _buf[_which] + _last_bytes;
+      if (_mapped) return false;
+
+      // keep a possibly incomplete match
+      size_t keep = std::min<size_t>(needle.size() - 1, _last_bytes);
+      memmove(_buf[!_which], end - keep, keep);
+
+      size_t readb = fill(_buf[!_which] + keep, BUFFER_S - keep);
+      if (!readb) return false;
+      _tot_read_bef += _last_new_data;
+      _which = !_which;
+      _last_new_data = readb;
+      _last_bytes = _last_new_data + keep;
+      _c = _buf[_which];
+      end = _buf[_which] + _last_bytes;
+    }
+  }
+
+  while (_s.tag_stack.size() > 1 && !is_top(name)) _s.tag_stack.pop();
+  if (_s.tag_stack.size() > 1) _s.tag_stack.pop();
+
+  _s.s = NONE;
+  _s.hanging = 0;
+  _ret.name = 0;
+  _ret.text = empty_str;
+  _ret.attrs.clear();
+  return true;
+}
+
+// _____________________________________________________________________________
+inline bool file::jump(const char* name, const char* stop) {
+  // move to the next <name> tag without tokenizing anything before it, for
+  // documents with a known schema. The tag is taken to be a child of the
+  // currently open element, so everything skipped must be complete elements.
+  // If stop, usually the closing tag of the current element, comes first,
+  // move to stop instead and return false. Afterwards, the next call of
+  // next() returns the found tag or tokenizes stop. The text returned by the
+  // previous call of next() is no longer terminated.
+
+  std::string needle = std::string("<") + name;
+  size_t stop_len = strlen(stop);
+
+  if (_s.s == IN_TAG_TENTATIVE) {
+    // the '<' of a tag directly following text was already consumed
+    *--_c = '<';
+    _s.s = NONE;
+  }
+
+  const char* end = _buf[_which] + _last_bytes;
+  bool found;
+
+  while (true) {
+    const char* p = _c;
+    while ((p = static_cast<const char*>(
+                memmem(p, end - p, needle.c_str(), needle.size())))) {
+      if (p + needle.size() == end) {
+        // the tag may continue in the next buffer
+        p = 0;
+        break;
+      }
+      char c = p[needle.size()];
+      if (c == '>' || c == '/' || is_space(c)) break;
+      p++;
+    }
+
+    // stop only counts if it starts before the tag
+    const char* lim = p ? std::min(end, p + stop_len - 1) : end;
+    const char* q =
+        static_cast<const char*>(memmem(_c, lim - _c, stop, stop_len));
+
+    if (q || p) {
+      _c = const_cast<char*>(q ? q : p);
+      found = !q;
+      break;
+    }
+
+    if (_mapped) {
+      _c = _buf[_which] + _last_bytes;
+      return false;
+    }
+
+    // keep a possibly incomplete match
+    size_t keep = std::min<size_t>(std::max(needle.size(), stop_len - 1),
+                                   _last_bytes - (_c - _buf[_which]));
+    memmove(_buf[!_which], end - keep, keep);
+
+    size_t readb = fill(_buf[!_which] + keep, BUFFER_S - keep);
+    _c = _buf[_which] + _last_bytes;
+    if (!readb) return false;
+    _tot_read_bef += _last_new_data;
+    _which = !_which;
+    _last_new_data = readb;
+    _last_bytes = _last_new_data + keep;
+    _c = _buf[_which];
+    end = _buf[_which] + _last_bytes;
+  }
+
+  _s.s = NONE;
+  _ret.name = 0;
+  _ret.text = empty_str;
+  _ret.attrs.clear();
+  return found;
+}
+
+// _____________________________________________________________________________
+inline int64_t file::offset() const {
+  // byte offset of the current opening tag
+  return _tot_read_bef + (_ret.name - _buf[_which]) - 1 -
+         (_last_bytes - _last_new_data);
+}
+
+// _____________________________________________________________________________
+inline int64_t file::consumed() const {
+  // byte offset up to which the input was parsed or skipped
+  return _tot_read_bef + (_c - _buf[_which]) - (_last_bytes - _last_new_data);
+}
+
 // _____________________________________________________________________________
 inline const tag& file::get() const { return _ret; }
 
@@ -713,8 +1797,9 @@ inline bool file::next() {
   }
   _prevs.s = _s.s;
   _prevs.hanging = _s.hanging;
-  _prevs.off =
-      _tot_read_bef + (_c - _buf[_which]) - (_last_bytes - _last_new_data);
+  _prevs.off = consumed();
+
+  if (_mapped) advise();
 
   if (_s.hanging) _s.hanging--;
   _ret.name = 0;
@@ -726,7 +1811,7 @@ inline bool file::next() {
       char c = *_c;
       switch (_s.s) {
         case NONE:
-          if (std::isspace(c))
+          if (is_space(c))
             continue;
           else if (c == '<') {
             _s.s = IN_TAG_TENTATIVE;
@@ -803,16 +1888,16 @@ inline bool file::next() {
           } else if (c == '!') {
             _s.s = IN_COMMENT_TENTATIVE;
             continue;
-          } else if (std::isalnum(c) || c == '-' || c == '_' || c == '.') {
+          } else if (is_name_char(c)) {
             _s.s = IN_TAG_NAME;
             _ret.name = _c;
             continue;
           }
 
         case IN_TAG:
-          if (std::isspace(c))
+          if (is_space(c))
             continue;
-          else if (std::isalnum(c) || c == '-' || c == '_' || c == '.') {
+          else if (is_name_char(c)) {
             _s.s = IN_ATTRKEY;
             _tmp = _c;
             continue;
@@ -821,7 +1906,7 @@ inline bool file::next() {
             continue;
           } else if (c == '>') {
             _s.hanging++;
-            _s.tag_stack.push(_ret.name);
+            push_tag(_ret.name);
             _s.s = WS_SKIP;
             continue;
           }
@@ -853,7 +1938,7 @@ inline bool file::next() {
           continue;
 
         case AW_IN_ATTRVAL:
-          if (std::isspace(c))
+          if (is_space(c))
             continue;
           else if (c == '\'') {
             _s.s = IN_ATTRVAL_SQ;
@@ -868,12 +1953,11 @@ inline bool file::next() {
                           _prevs.off);
 
         case IN_ATTRKEY:
-          if (std::isspace(c)) {
+          if (is_space(c)) {
             *_c = 0;
             _s.s = AFTER_ATTRKEY;
             continue;
-          } else if (std::isalnum(c) || c == '-' || c == '_' || c == '.' ||
-                     c == ':') {
+          } else if (is_name_char(c) || c == ':') {
             continue;
           } else if (c == '=') {
             *_c = 0;
@@ -885,7 +1969,7 @@ inline bool file::next() {
                           _buf[_which], _prevs.off);
 
         case AFTER_ATTRKEY:
-          if (std::isspace(c))
+          if (is_space(c))
             continue;
           else if (c == '=') {
             _s.s = AW_IN_ATTRVAL;
@@ -896,21 +1980,21 @@ inline bool file::next() {
               _path, _c, _buf[_which], _prevs.off);
 
         case IN_TAG_NAME:
-          if (std::isspace(c)) {
+          if (is_space(c)) {
             *_c = 0;
             _s.s = IN_TAG;
             continue;
           } else if (c == '>') {
             *_c = 0;
             _s.hanging++;
-            _s.tag_stack.push(_ret.name);
+            push_tag(_ret.name);
             _s.s = WS_SKIP;
             continue;
           } else if (c == '/') {
             *_c = 0;
             _s.s = AW_CLOSING;
             continue;
-          } else if (std::isalnum(c) || c == '-' || c == '_' || c == '.') {
+          } else if (is_name_char(c)) {
             continue;
           }
 
@@ -924,18 +2008,18 @@ inline bool file::next() {
           continue;
 
         case IN_TAG_NAME_CLOSE:
-          if (std::isspace(c)) {
+          if (is_space(c)) {
             *_c = 0;
             _s.s = IN_TAG_CLOSE;
             continue;
-          } else if (std::isalnum(c) || c == '-' || c == '_' || c == '.') {
+          } else if (is_name_char(c)) {
             continue;
           } else if (c == '>') {
             *_c = 0;
-            if (_tmp != _s.tag_stack.top()) {
+            if (!is_top(_tmp)) {
               throw parse_exc(std::string("Closing wrong tag '<") + _tmp +
                                   ">', expected close of '<" +
-                                  _s.tag_stack.top() + ">'.",
+                                  _tag_names.name(_s.tag_stack.top()) + ">'.",
                               _path, _c, _buf[_which], _prevs.off);
             }
             _s.tag_stack.pop();
@@ -944,13 +2028,13 @@ inline bool file::next() {
           }
 
         case IN_TAG_CLOSE:
-          if (std::isspace(c))
+          if (is_space(c))
             continue;
           else if (c == '>') {
-            if (_tmp != _s.tag_stack.top()) {
+            if (!is_top(_tmp)) {
               throw parse_exc(std::string("Closing wrong tag '<") + _tmp +
                                   ">', expected close of '<" +
-                                  _s.tag_stack.top() + ">'.",
+                                  _tag_names.name(_s.tag_stack.top()) + ">'.",
                               _path, _c, _buf[_which], _prevs.off);
             }
             _s.tag_stack.pop();
@@ -966,12 +2050,15 @@ inline bool file::next() {
           }
 
         case WS_SKIP:
-          if (std::isspace(c)) continue;
+          if (is_space(c)) continue;
           _s.s = NONE;
           return true;
       }
     }
 
+    // the mapping is the whole file
+    if (_mapped) break;
+
     // buffer ended, read new stuff, but copy remaining if needed
     size_t off = 0;
     if (_s.s == IN_TAG_NAME) {  //|| IN_TAG_NAME_META) {
@@ -991,7 +2078,7 @@ inline bool file::next() {
 
     assert(off <= BUFFER_S);
 
-    size_t readb = read(_file, _buf[!_which] + off, BUFFER_S - off);
+    size_t readb = fill(_buf[!_which] + off, BUFFER_S - off);
     if (!readb) break;
     _tot_read_bef += _last_new_data;
     _which = !_which;
@@ -1001,7 +2088,7 @@ inline bool file::next() {
   }
 
   if (_s.tag_stack.size()) {
-    if (_s.tag_stack.top() != "[root]") {
+    if (_s.tag_stack.top() != ROOT_TAG) {
       throw parse_exc("XML tree not complete", _path, _c, _buf[_which],
                       _prevs.off);
     }
@@ -1019,16 +2106,18 @@ inline std::string file::decode(const std::string& str) {
 
 // _____________________________________________________________________________
 inline std::string file::decode(const char* str) {
-  const char* c = strchr(str, '&');
-  if (!c) return str;
+  std::string ret;
+  decode(str, &ret);
+  return ret;
+}
 
-  char* dec_ret = new char[strlen(str) + 1];
+// _____________________________________________________________________________
+inline void file::decode(const char* str, std::string* ret) {
+  // append the decoded str to ret. A decoded 0 character ends the string.
   const char* last = str;
-  char* dst_pt = dec_ret;
 
-  for (; c != 0; c = strchr(c + 1, '&')) {
-    memcpy(dst_pt, last, c - last);
-    dst_pt += c - last;
+  for (const char* c = strchr(str, '&'); c != 0; c = strchr(c + 1, '&')) {
+    ret->append(last, c - last);
     last = c;
 
     if (*(c + 1) == '#') {
@@ -1041,33 +2130,124 @@ inline std::string file::decode(const char* str) {
         cp = strtoul(c + 2, &tail, 10);
 
       if (*tail == ';' && cp <= 0x1FFFFF && !errno) {
-        dst_pt += utf8(cp, dst_pt);
+        if (!cp) return;
+        char u[4];
+        ret->append(u, utf8(cp, u));
         last = tail + 1;
       }
     } else {
       const char* e = strchr(c, ';');
       if (e) {
-        char* ent = new char[e - 1 - c + 1];
-        memcpy(ent, c + 1, e - 1 - c);
-        ent[e - 1 - c] = 0;
-        const auto it = ENTITIES.find(ent);
-        if (it != ENTITIES.end()) {
-          const char* utf8 = it->second;
-          memcpy(dst_pt, utf8, strlen(utf8));
-          dst_pt += strlen(utf8);
-          last += strlen(ent) + 2;
+        const char* u = entity(c + 1, e - 1 - c);
+        if (u) {
+          ret->append(u);
+          last = e + 1;
         }
-        delete[] ent;
       }
     }
   }
 
-  strcpy(dst_pt, last);
-  std::string ret(dec_ret);
-  delete[] dec_ret;
+  ret->append(last);
+}
+
+// _____________________________________________________________________________
+inline const char* file::entity(const char* name, size_t len) {
+  static const entity_table table;
+  return table.get(name, len);
+}
+
+// _____________________________________________________________________________
+inline tag_names::tag_names() : _slots(64, 0) { id("[root]"); }
+
+// _____________________________________________________________________________
+inline uint32_t tag_names::id(const char* name) {
+  size_t mask = _slots.size() - 1;
+  size_t i = hash(name) & mask;
+  for (; _slots[i]; i = (i + 1) & mask) {
+    if (strcmp(_names[_slots[i] - 1].c_str(), name) == 0) {
+      return _slots[i] - 1;
+    }
+  }
+
+  uint32_t ret = _names.size();
+  _names.push_back(name);
+  _slots[i] = ret + 1;
+
+  if (_names.size() * 2 > _slots.size()) {
+    // rehash into a table of twice the size
+    _slots.assign(_slots.size() * 2, 0);
+    mask = _slots.size() - 1;
+    for (uint32_t id = 0; id < _names.size(); id++) {
+      size_t j = hash(_names[id].c_str()) & mask;
+      while (_slots[j]) j = (j + 1) & mask;
+      _slots[j] = id + 1;
+    }
+  }
   return ret;
 }
 
+// _____________________________________________________________________________
+inline const char* tag_names::name(uint32_t id) const {
+  return _names[id].c_str();
+}
+
+// _____________________________________________________________________________
+inline size_t tag_names::hash(const char* name) {
+  // FNV-1a
+  size_t h = 14695981039346656037ull;
+  for (; *name; name++) {
+    h = (h ^ static_cast<unsigned char>(*name)) * 1099511628211ull;
+  }
+  return h;
+}
+
+// _____________________________________________________________________________
+inline entity_table::entity_table() : _mul(0) {
+  for (const auto& e : ENTITIES) {
+    if (strchr(e.first.c_str(), ';')) continue;
+    assert(e.first.size() <= MAX_ENTITY_S);
+    _keys.push_back(pack(e.first.c_str(), e.first.size()));
+    _vals.push_back(e.second);
+  }
+
+  // try multipliers from a fixed pseudo-random sequence until the table is
+  // collision-free, for ~250 names in 4096 slots this takes a few thousand
+  // tries
+  uint64_t x = 0x9E3779B97F4A7C15ULL;
+  while (true) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    _mul = x | 1;
+
+    memset(_slots, 0, sizeof(_slots));
+    size_t i = 0;
+    for (; i < _keys.size(); i++) {
+      uint16_t& s = _slots[slot(_keys[i])];
+      if (s) break;
+      s = i + 1;
+    }
+    if (i == _keys.size()) return;
+  }
+}
+
+// _____________________________________________________________________________
+inline const char* entity_table::get(const char* name, size_t len) const {
+  if (!len || len > MAX_ENTITY_S) return 0;
+  uint64_t key = pack(name, len);
+  uint16_t s = _slots[slot(key)];
+  if (s && _keys[s - 1] == key) return _vals[s - 1];
+  return 0;
+}
+
+// _____________________________________________________________________________
+inline uint64_t entity_table::pack(const char* name, size_t len) {
+  // the names are unique up to their length, which is at most 8
+  uint64_t key = 0;
+  memcpy(&key, name, len);
+  return key;
+}
+
 // _____________________________________________________________________________
 inline size_t file::utf8(size_t cp, char* out) {
   if (cp <= 0x7F) {